@@ -0,0 +1,287 @@
+
+// Dependencies:
+#include <ecs/ecs.hpp>
+#include <engine/core/engine.hpp>
+#include <engine/core/job_system.hpp>
+
+// Dependencies (3rd party):
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <random>
+
+using namespace jbx;
+
+/*
+    Self check of the round trips of the registry state, built once per storage mode with the
+    { PROJECT_BUILD_CHECKS } CMake option and run by { ctest }:
+    - { Frame_History }: frames restored out of order with structural changes in between, and frames saved
+      before and after { Registry::set_pool_order } reordered the pools.
+    - { Snapshot }: a registry saved and loaded into an empty one.
+
+    Every failed check is printed, the exit code is the number of them.
+*/
+
+static int failed_checks = 0;
+
+static void
+check(bool condition, cstr_t what) {
+    if (!condition) {
+        std::printf("FAILED: %s\n", what);
+        failed_checks += 1;
+    }
+}
+
+/*
+    Keeps the entities with a rect and a velocity, to check the system membership after a restore.
+*/
+class Check_System final : public Base_System {
+public:
+    Check_System() {
+        component_mask.add<Rect>();
+        component_mask.add<Velocity>();
+    }
+
+    void
+    update(f64) override {
+    }
+};
+
+/*
+    Reverses the order of the pools, so every pass of { Registry::set_pool_order } moves the components.
+*/
+static void
+get_reversed_keys(Registry&, int first_entity_id, int count, u64* keys) {
+    for (int index = 0; index < count; index++) {
+        keys[index] = ~static_cast<u64>(first_entity_id + index);
+    }
+}
+
+static u64
+mix(u64 hash, u64 value) {
+    return (hash ^ value) * 1099511628211ull;
+}
+
+template <typename T>
+static u64
+hash_bytes(const T& value) {
+    u64 hash = 14695981039346656037ull;
+    u8 bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    for (u8 byte: bytes) {
+        hash = mix(hash, byte);
+    }
+
+    return hash;
+}
+
+/*
+    Everything a round trip must bring back: the living entities of { entities }, their masks, groups and
+    components. Components are read through const views, so hashing does not mark them as changed, and
+    summed per entity, so the order of the pools does not matter.
+*/
+static u64
+hash_registry(Registry& registry, const std::vector<Entity>& entities) {
+    u64 hash = 0;
+    for (const Entity& entity: entities) {
+        if (registry.is_alive(entity)) {
+            const u64 group = registry.entity_belongs_to_group(entity, "checked") ? 1 : 0;
+            hash += mix(mix(hash_bytes(entity), registry.get_component_mask(entity).get_word(0)), group);
+        }
+    }
+
+    registry.view<const Rect>().each([&](Entity entity, const Rect& rect) {
+        hash += mix(hash_bytes(entity), hash_bytes(rect));
+    });
+    registry.view<const Velocity>().each([&](Entity entity, const Velocity& velocity) {
+        hash += mix(hash_bytes(entity), hash_bytes(velocity));
+    });
+    registry.view<const Color>().each([&](Entity entity, const Color& color) {
+        hash += mix(hash_bytes(entity), hash_bytes(color));
+    });
+
+    return hash;
+}
+
+static int
+get_member_count(Registry& registry) {
+    return static_cast<int>(registry.get_system<Check_System>().get_entities().size());
+}
+
+static Entity
+spawn(Registry& registry, std::vector<Entity>& entities, std::mt19937& random) {
+    const Entity entity = registry.create_entity();
+    const f32 position  = static_cast<f32>(random() % 1000);
+
+    registry.add_component<Rect>(entity, position, position, 1.0f, 1.0f);
+    if (random() % 2 == 0) {
+        registry.add_component<Velocity>(entity, 1.0f, -1.0f);
+    }
+
+    if (random() % 3 == 0) {
+        registry.add_component<Color>(entity, static_cast<u8>(entity.id), 0, 0, 255);
+    }
+
+    entities.push_back(entity);
+    return entity;
+}
+
+/*
+    One tick of a game: every few ticks entities are killed, created, grouped and get or lose components,
+    then the rects move.
+*/
+static void
+simulate(Registry& registry, std::vector<Entity>& entities, std::mt19937& random, int tick) {
+    if (tick % 2 == 1) {
+        for (int change = 0; change < 32; change++) {
+            const Entity entity = entities[random() % entities.size()];
+            if (!registry.is_alive(entity)) {
+                continue;
+            }
+
+            switch (random() % 4) {
+                case 0:  registry.kill_entity(entity);                            break;
+                case 1:  registry.remove_component<Velocity>(entity);             break;
+                case 2:  registry.add_component<Velocity>(entity, -2.0f, 0.5f);   break;
+                default: registry.group_entity(entity, "checked");                break;
+            }
+        }
+
+        for (int count = 0; count < 16; count++) {
+            spawn(registry, entities, random);
+        }
+    }
+
+    registry.update();
+    registry.view<Rect, const Velocity>().each([](Entity, Rect& rect, const Velocity& velocity) {
+        rect.x += velocity.x;
+        rect.y += velocity.y;
+    });
+}
+
+static void
+check_frame_history() {
+    constexpr int ENTITY_COUNT = 4096;
+    constexpr int TICK_COUNT   = 12;
+    constexpr int DEPTH        = 8;
+
+    std::mt19937 random(1);
+    std::vector<Entity> entities;
+
+    Registry registry;
+    registry.add_system<Check_System>();
+    for (int count = 0; count < ENTITY_COUNT; count++) {
+        spawn(registry, entities, random);
+    }
+    registry.update();
+
+    Frame_History history(registry, DEPTH);
+    history.track<Rect, Velocity, Color>();
+
+    std::vector<u64> hashes;
+    std::vector<int> member_counts;
+    auto save = [&]() {
+        const u64 frame = history.save();
+        hashes.resize(frame + 1);
+        member_counts.resize(frame + 1);
+        hashes[frame]        = hash_registry(registry, entities);
+        member_counts[frame] = get_member_count(registry);
+        return frame;
+    };
+
+    save();
+    for (int tick = 1; tick <= TICK_COUNT; tick++) {
+        simulate(registry, entities, random, tick);
+        save();
+    }
+
+    check(!history.has_frame(history.get_oldest_frame() - 1), "Frame_History drops the oldest frames");
+
+    // Out of order, back and forth over structural changes:
+    const u64 newest = history.get_newest_frame();
+    for (u64 frame: { newest - 5, newest, newest - 7, newest - 3, newest - 6, newest, newest - 1 }) {
+        const u32 change_tick = registry.get_change_tick();
+        check(history.restore(frame), "Frame_History restores a frame in the history");
+        check(hash_registry(registry, entities) == hashes[frame], "Frame_History restores entities and components");
+        check(get_member_count(registry) == member_counts[frame], "Frame_History restores system membership");
+        check(registry.get_change_tick() == change_tick, "Frame_History restores without advancing the change tick");
+    }
+
+    // Kills recorded before a restore belong to the state which is replaced:
+    history.restore(newest);
+    const Entity member = registry.get_system<Check_System>().get_entities().front();
+    registry.kill_entity(member);
+    history.restore(newest);
+    registry.update();
+    check(registry.is_alive(member) && hash_registry(registry, entities) == hashes[newest], "Frame_History drops pending kills");
+
+    // Resimulating after a restore drops the frames after it:
+    history.restore(newest - 2);
+    simulate(registry, entities, random, 1);
+    const u64 resimulated = save();
+    check(resimulated == newest - 1 && history.get_newest_frame() == resimulated, "Frame_History drops frames after a restore");
+
+    // Frames saved before and after the pools were reordered, archetypes are never reordered:
+    const u64 before_order = save();
+#if !PROJECT_ECS_STORAGE_ARCHETYPES
+    registry.set_pool_order(get_reversed_keys, 1 << 20);
+    while (registry.get_pool_order_pass_count() == 0) {
+        registry.update();
+    }
+    registry.set_pool_order(nullptr, 0);
+#endif
+
+    const u64 after_order = save();
+    registry.view<Rect>().each([](Entity, Rect& rect) {
+        rect.x = -1.0f;
+    });
+
+    for (u64 frame: { after_order, before_order, after_order, before_order }) {
+        history.restore(frame);
+        check(hash_registry(registry, entities) == hashes[frame], "Frame_History restores frames saved around a pool reorder");
+    }
+}
+
+static void
+check_snapshot() {
+    std::mt19937 random(2);
+    std::vector<Entity> entities;
+    const std::string file_path = (std::filesystem::temp_directory_path() / "ecs_checks.snapshot").string();
+
+    Registry registry;
+    for (int tick = 1; tick <= 6; tick++) {
+        for (int count = 0; count < 512; count++) {
+            spawn(registry, entities, random);
+        }
+
+        simulate(registry, entities, random, tick);
+    }
+
+    check(Snapshot::save<Rect, Velocity, Color>(registry, file_path), "Snapshot saves");
+
+    Registry loaded;
+    check(Snapshot::load<Rect, Velocity, Color>(loaded, file_path), "Snapshot loads");
+    loaded.update();
+    check(hash_registry(loaded, entities) == hash_registry(registry, entities), "Snapshot loads what was saved");
+
+    // The free list is part of the snapshot, both registries hand out the same entity next:
+    check(loaded.create_entity() == registry.create_entity(), "Snapshot keeps the free entity ids");
+
+    std::filesystem::remove(file_path);
+}
+
+int
+main() {
+    get_context<Job_System>();
+
+    check_frame_history();
+    check_snapshot();
+
+#if PROJECT_ECS_STORAGE_ARCHETYPES
+    std::printf("ECS checks (archetypes): %s\n", failed_checks == 0 ? "passed" : "failed");
+#else
+    std::printf("ECS checks (pools): %s\n", failed_checks == 0 ? "passed" : "failed");
+#endif
+
+    return failed_checks;
+}
@@ -0,0 +1,295 @@
+
+// Implements:
+#include <ecs/Archetype.hpp>
+
+// Dependencies (3rd party):
+#include <algorithm>
+
+namespace jbx {
+
+    /*
+    ## Archetype: implementation
+    */
+
+    static inline int
+    align_up(int offset, int alignment) {
+        return (offset + alignment - 1) & ~(alignment - 1);
+    }
+
+    Archetype::Archetype(const Component_Mask& mask, const std::vector<const Component_Info*>& infos)
+    : mask(mask), chunk_capacity(0), entity_count(0) {
+        std::fill_n(column_of, MAX_COMPONENT_TYPES, NO_COLUMN);
+
+        // Columns are ordered by component type id:
+        int row_size = sizeof(int);
+        for (int type_id = 0; type_id < MAX_COMPONENT_TYPES; type_id++) {
+            if (mask.test(type_id)) {
+                ERROR_IF(type_id >= static_cast<int>(infos.size()) || infos[type_id] == nullptr, "Component type was not registered!");
+
+                column_of[type_id] = static_cast<s16>(column_infos.size());
+                column_infos.push_back(infos[type_id]);
+                row_size += infos[type_id]->size;
+            }
+        }
+
+        /*
+            Start from the capacity that ignores padding, then shrink it until every aligned column fits into
+            the chunk. Entity ids are the first column.
+        */
+        chunk_capacity = ARCHETYPE_CHUNK_SIZE / row_size;
+        while (chunk_capacity > 0) {
+            column_offsets.clear();
+
+            int offset = chunk_capacity * static_cast<int>(sizeof(int));
+            for (const Component_Info* info: column_infos) {
+                offset = align_up(offset, info->alignment);
+                column_offsets.push_back(offset);
+                offset += chunk_capacity * info->size;
+            }
+
+            if (offset <= ARCHETYPE_CHUNK_SIZE) {
+                break;
+            }
+
+            chunk_capacity -= 1;
+        }
+
+        ERROR_IF(chunk_capacity <= 0, "Components of this archetype do not fit into a single chunk!");
+    }
+
+    void
+    Archetype::push_row(int entity_id, int& out_chunk, int& out_row) {
+        // Every chunk but the last one is always full:
+        if (chunks.empty() || chunks.back()->count == chunk_capacity) {
+            chunks.push_back(std::make_unique<Archetype_Chunk>());
+        }
+
+        out_chunk = static_cast<int>(chunks.size()) - 1;
+        out_row   = chunks.back()->count;
+
+        get_entity_ids(out_chunk)[out_row] = entity_id;
+        chunks.back()->count += 1;
+        entity_count         += 1;
+    }
+
+    int
+    Archetype::swap_remove_row(int chunk, int row) {
+        const int last_chunk = static_cast<int>(chunks.size()) - 1;
+        const int last_row   = chunks[last_chunk]->count - 1;
+        int moved_entity_id  = -1;
+
+        // Move the last row into the hole, column by column:
+        if (chunk != last_chunk || row != last_row) {
+            for (int column = 0; column < get_column_count(); column++) {
+                const Component_Info& info = *column_infos[column];
+
+                u8* source      = get_column_data(last_chunk, column) + last_row * info.size;
+                u8* destination = get_column_data(chunk, column) + row * info.size;
+
+                info.move_construct(destination, source);
+                info.destroy(source);
+            }
+
+            moved_entity_id            = get_entity_ids(last_chunk)[last_row];
+            get_entity_ids(chunk)[row] = moved_entity_id;
+        }
+
+        // Shrink, release the last chunk once it's empty:
+        chunks[last_chunk]->count -= 1;
+        entity_count              -= 1;
+
+        if (chunks[last_chunk]->count == 0) {
+            chunks.pop_back();
+        }
+
+        return moved_entity_id;
+    }
+
+    /*
+    ## Archetype_Storage: implementation
+    */
+
+    Archetype_Storage::~Archetype_Storage() {
+        // Chunks are raw memory, so the components must be destroyed explicitly:
+        for (Unique<Archetype>& archetype: archetypes) {
+            for (int chunk = 0; chunk < archetype->get_chunk_count(); chunk++) {
+                const int count = archetype->get_chunk(chunk).count;
+
+                for (int column = 0; column < archetype->get_column_count(); column++) {
+                    const Component_Info& info = archetype->get_column_info(column);
+                    u8* data                   = archetype->get_column_data(chunk, column);
+
+                    for (int row = 0; row < count; row++) {
+                        info.destroy(data + row * info.size);
+                    }
+                }
+            }
+        }
+    }
+
+    void
+    Archetype_Storage::register_component(const Component_Info& info) {
+        if (info.type_id >= static_cast<int>(infos.size())) {
+            infos.resize(info.type_id + 1, nullptr);
+        }
+
+        ERROR_IF(infos[info.type_id] != nullptr && infos[info.type_id] != &info, "Two component types share the same id!");
+        infos[info.type_id] = &info;
+    }
+
+    int
+    Archetype_Storage::find_or_create_archetype(const Component_Mask& mask) {
+        auto archetype = archetype_by_mask.find(mask);
+        if (archetype != archetype_by_mask.end()) {
+            return archetype->second;
+        }
+
+        const int index = static_cast<int>(archetypes.size());
+        archetypes.push_back(std::make_unique<Archetype>(mask, infos));
+        archetype_by_mask.emplace(mask, index);
+
+        return index;
+    }
+
+    void
+    Archetype_Storage::move_entity(int entity_id, int destination_archetype) {
+        Entity_Location& location = get_location(entity_id);
+        Archetype& destination    = *archetypes[destination_archetype];
+
+        int chunk, row;
+        destination.push_row(entity_id, chunk, row);
+
+        if (location.archetype >= 0) {
+            Archetype& source = *archetypes[location.archetype];
+
+            // Move the shared components, destroy the rest:
+            for (int column = 0; column < source.get_column_count(); column++) {
+                const Component_Info& info = source.get_column_info(column);
+                u8* from                   = source.get_column_data(location.chunk, column) + location.row * info.size;
+
+                const int destination_column = destination.get_column(info.type_id);
+                if (destination_column != Archetype::NO_COLUMN) {
+                    info.move_construct(destination.get_column_data(chunk, destination_column) + row * info.size, from);
+                }
+
+                info.destroy(from);
+            }
+
+            // Fill the hole in the source archetype, the entity moved into it gets a new location:
+            const int moved_entity_id = source.swap_remove_row(location.chunk, location.row);
+            if (moved_entity_id >= 0) {
+                locations[moved_entity_id] = location;
+            }
+        }
+
+        location.archetype = destination_archetype;
+        location.chunk     = chunk;
+        location.row       = row;
+    }
+
+    void
+    Archetype_Storage::remove_from_archetype(int entity_id) {
+        Entity_Location& location = locations[entity_id];
+        Archetype& archetype      = *archetypes[location.archetype];
+
+        for (int column = 0; column < archetype.get_column_count(); column++) {
+            const Component_Info& info = archetype.get_column_info(column);
+            info.destroy(archetype.get_column_data(location.chunk, column) + location.row * info.size);
+        }
+
+        const int moved_entity_id = archetype.swap_remove_row(location.chunk, location.row);
+        if (moved_entity_id >= 0) {
+            locations[moved_entity_id] = location;
+        }
+
+        location = Entity_Location();
+    }
+
+    void
+    Archetype_Storage::remove_entity(int entity_id) {
+        if (entity_id < static_cast<int>(locations.size()) && locations[entity_id].archetype >= 0) {
+            remove_from_archetype(entity_id);
+        }
+    }
+
+    void
+    Archetype_Storage::insert_entity(int entity_id, const Component_Mask& mask) {
+        ERROR_IF(get_location(entity_id).archetype >= 0, "Entity already has components!");
+        mask.for_each([&](int component_type_id) {
+            ERROR_IF(component_type_id >= static_cast<int>(infos.size()) || infos[component_type_id] == nullptr, "Component type was not registered!");
+        });
+
+        move_entity(entity_id, find_or_create_archetype(mask));
+    }
+
+    void
+    Archetype_Storage::mark_changed(int component_type_id, int entity_id) {
+        if (component_type_id >= static_cast<int>(change_ticks.size())) {
+            change_ticks.resize(component_type_id + 1);
+        }
+
+        std::vector<u32>& ticks = change_ticks[component_type_id];
+        if (entity_id >= static_cast<int>(ticks.size())) {
+            ticks.resize(entity_id + 1, NO_TICK);
+        }
+
+        ticks[entity_id] = *current_tick;
+    }
+
+    u32
+    Archetype_Storage::get_change_tick(int component_type_id, int entity_id) const {
+        // Every component was marked when it was added, so its tick exists:
+        return change_ticks[component_type_id][entity_id];
+    }
+
+    void
+    Archetype_Storage::set_tick_source(const u32* tick) {
+        current_tick = tick;
+    }
+
+    int
+    Archetype_Storage::get_archetype_count() const {
+        return static_cast<int>(archetypes.size());
+    }
+
+    Archetype&
+    Archetype_Storage::get_archetype(int index) {
+        return *archetypes[index];
+    }
+
+    void
+    Archetype_Storage::trim_entities(int entity_count) {
+        if (entity_count < static_cast<int>(locations.size())) {
+            locations.resize(entity_count);
+            locations.shrink_to_fit();
+        }
+
+        for (std::vector<u32>& ticks: change_ticks) {
+            if (entity_count < static_cast<int>(ticks.size())) {
+                ticks.resize(entity_count);
+                ticks.shrink_to_fit();
+            }
+        }
+    }
+
+    u64
+    Archetype_Storage::get_chunk_bytes() const {
+        u64 bytes = 0;
+        for (const Unique<Archetype>& archetype: archetypes) {
+            bytes += static_cast<u64>(archetype->get_chunk_count()) * sizeof(Archetype_Chunk);
+        }
+
+        return bytes;
+    }
+
+    u64
+    Archetype_Storage::get_entity_bytes() const {
+        u64 bytes = locations.capacity() * sizeof(Entity_Location);
+        for (const std::vector<u32>& ticks: change_ticks) {
+            bytes += ticks.capacity() * sizeof(u32);
+        }
+
+        return bytes;
+    }
+
+} // jbx
@@ -0,0 +1,579 @@
+
+#pragma once
+
+#include <ecs/Entity.hpp>
+#include <ecs/Component.hpp>
+
+// Dependencies (3rd party):
+#include <utility>
+
+namespace jbx {
+
+    /*
+        Alternative component storage, enabled with { PROJECT_ECS_STORAGE=Archetypes }.
+
+        Entities with the same { Component_Mask } belong to the same { Archetype }, which stores them in
+        fixed size chunks. Every chunk is laid out as SoA: a column of entity ids followed by one column per
+        component type, so a system touching { Rect, Velocity, Texture } reads 3 contiguous arrays per chunk
+        instead of jumping between 3 pools.
+
+        Adding or removing a component moves the entity (all of its components) to the archetype of the new
+        mask, which makes structural changes more expensive than with pools.
+    */
+    constexpr int ARCHETYPE_CHUNK_SIZE = 16 * 1024;
+
+    struct Archetype_Chunk {
+        alignas(64) u8 bytes[ARCHETYPE_CHUNK_SIZE];
+        int            count = 0;
+    };
+
+    class Archetype final {
+    public:
+        static constexpr s16 NO_COLUMN = -1;
+
+    private:
+        Component_Mask                       mask;
+        int                                  chunk_capacity;
+        std::vector<int>                     column_offsets;
+        std::vector<const Component_Info*>   column_infos;
+        s16                                  column_of[MAX_COMPONENT_TYPES];
+        std::vector<Unique<Archetype_Chunk>> chunks;
+        int                                  entity_count;
+
+    public:
+        Archetype(const Component_Mask& mask, const std::vector<const Component_Info*>& infos);
+
+        const Component_Mask&
+        get_mask() const;
+
+        /*
+            Column index of the given component type, or { NO_COLUMN } if the archetype does not have it.
+        */
+        int
+        get_column(int component_type_id) const;
+
+        int
+        get_column_count() const;
+
+        const Component_Info&
+        get_column_info(int column) const;
+
+        int
+        get_chunk_count() const;
+
+        int
+        get_entity_count() const;
+
+        Archetype_Chunk&
+        get_chunk(int chunk);
+
+        /*
+            Start of the entity id column of the chunk.
+        */
+        int*
+        get_entity_ids(int chunk);
+
+        /*
+            Start of the given column of the chunk, the component of row { r } is at { r * size }.
+        */
+        u8*
+        get_column_data(int chunk, int column);
+
+        /*
+            Reserve a row at the end of the archetype and return its location, components in that row are
+            not constructed.
+        */
+        void
+        push_row(int entity_id, int& out_chunk, int& out_row);
+
+        /*
+            Fill the given row with the last row of the archetype (components at the given row must already
+            be destroyed or moved out). Returns the id of the entity which was moved, or -1 if the given row
+            was the last one.
+        */
+        int
+        swap_remove_row(int chunk, int row);
+    };
+
+    /*
+        Where the components of an entity currently live, { archetype } is -1 for entities without any
+        components.
+    */
+    struct Entity_Location {
+        int archetype = -1;
+        int chunk     = 0;
+        int row       = 0;
+    };
+
+    class Archetype_Storage;
+
+    /*
+        Typed accessor for a single component type, stands in for { Pool<T> } so systems can resolve their
+        storage once and call { get } per entity, regardless of the storage mode.
+    */
+    class Base_Archetype_Column {
+    public:
+        virtual ~Base_Archetype_Column() {}
+    };
+
+    template <typename T>
+    class Archetype_Column final : public Base_Archetype_Column {
+    private:
+        Archetype_Storage* storage;
+
+    public:
+        Archetype_Column(Archetype_Storage* storage);
+
+        bool
+        contains(int entity_id) const;
+
+        /*
+            Mutable access marks the component as changed, read only code should use a const column.
+        */
+        T&
+        get(int entity_id);
+
+        const T&
+        get(int entity_id) const;
+    };
+
+    /*
+        { change_ticks } holds the tick at which every component was added or last accessed mutably, indexed
+        by component type and then entity id, so it does not move with the rows.
+    */
+    class Archetype_Storage final {
+    private:
+        static inline const u32 NO_TICK = 0;
+
+        std::vector<Unique<Archetype>>                                archetypes;
+        std::unordered_map<Component_Mask, int, Component_Mask::Hash> archetype_by_mask;
+        std::vector<const Component_Info*>                            infos;
+        std::vector<Entity_Location>                                  locations;
+        std::vector<Unique<Base_Archetype_Column>>                    columns;
+        std::vector<std::vector<u32>>                                 change_ticks;
+        const u32*                                                    current_tick = &NO_TICK;
+
+    public:
+        Archetype_Storage()  = default;
+        ~Archetype_Storage();
+
+        Archetype_Storage(const Archetype_Storage&) = delete;
+
+        Archetype_Storage&
+        operator =(const Archetype_Storage&) = delete;
+
+        /*
+            Construct the component in place, moving the entity to the archetype with { T } first. If the
+            entity already has the component it's replaced.
+        */
+        template <typename T, typename ...T_Args>
+        T&
+        emplace(int entity_id, T_Args&& ...args);
+
+        /*
+            Remove the component, moving the entity to the archetype without { T }.
+        */
+        template <typename T>
+        void
+        remove(int entity_id);
+
+        template <typename T>
+        bool
+        contains(int entity_id) const;
+
+        /*
+            Mutable access marks the component as changed.
+        */
+        template <typename T>
+        T&
+        get(int entity_id);
+
+        template <typename T>
+        const T&
+        get(int entity_id) const;
+
+        template <typename T>
+        Archetype_Column<T>&
+        get_column();
+
+        /*
+            Set the component of the entity to the current tick, for writes which do not go through { get }.
+        */
+        void
+        mark_changed(int component_type_id, int entity_id);
+
+        u32
+        get_change_tick(int component_type_id, int entity_id) const;
+
+        /*
+            Set by the { Registry }, the tick must outlive the storage.
+        */
+        void
+        set_tick_source(const u32* tick);
+
+        /*
+            Destroy every component of the entity.
+        */
+        void
+        remove_entity(int entity_id);
+
+        /*
+            Place an entity which has no components yet into the archetype of { mask }, the components are
+            not constructed: the caller must construct every one of them in place, see { get }. Every type in
+            the { mask } must be registered. Used to load entities in bulk.
+        */
+        void
+        insert_entity(int entity_id, const Component_Mask& mask);
+
+        /*
+            Make the component type known to the storage, done on the first { emplace } of the type.
+        */
+        void
+        register_component(const Component_Info& info);
+
+        int
+        get_archetype_count() const;
+
+        Archetype&
+        get_archetype(int index);
+
+        /*
+            Forget every entity id from { entity_count } on, none of which may have components, and release
+            the per entity arrays beyond it, see { Registry::trim_entities }.
+        */
+        void
+        trim_entities(int entity_count);
+
+        /*
+            Memory held by the chunks of every archetype, and by the per entity arrays ({ locations } and
+            { change_ticks }), in bytes.
+        */
+        u64
+        get_chunk_bytes() const;
+
+        u64
+        get_entity_bytes() const;
+
+    private:
+
+        Entity_Location&
+        get_location(int entity_id);
+
+        int
+        find_or_create_archetype(const Component_Mask& mask);
+
+        /*
+            Move the entity with all the components it shares with the destination archetype, components
+            which the destination does not have are destroyed.
+        */
+        void
+        move_entity(int entity_id, int destination_archetype);
+
+        void
+        remove_from_archetype(int entity_id);
+    };
+
+    /*
+        { Archetype_View } is the archetype storage version of { View }, it visits every chunk of every
+        archetype whose mask contains all of { Ts... }.
+    */
+    template <typename ...Ts>
+    class Archetype_View final {
+    private:
+        Archetype_Storage&         storage;
+        const std::vector<Entity>& entity_slots;
+        Component_Mask             mask;
+
+    public:
+        Archetype_View(Archetype_Storage& storage, const std::vector<Entity>& entity_slots);
+
+        /*
+            Call { fn(Entity, Ts&...) } for every entity in the view, marks the components which are not
+            { const } as changed, same as { View::each }.
+        */
+        template <typename T_Fn>
+        void
+        each(T_Fn&& fn);
+
+        /*
+            Call { fn(int count, const int* entity_ids, Ts*...) } for every chunk, columns are contiguous
+            arrays of { count } elements. Components are not marked as changed, see
+            { Registry::mark_changed }.
+        */
+        template <typename T_Fn>
+        void
+        each_chunk(T_Fn&& fn);
+
+        int
+        size_hint() const;
+
+    private:
+        template <typename T_Fn, size_t ...I>
+        void
+        each_chunk_columns(T_Fn& fn, std::index_sequence<I...>);
+
+        template <typename T>
+        void
+        mark_changed(int entity_id);
+    };
+
+
+    /*
+    ## Archetype: inline implementations
+    */
+
+    inline const Component_Mask&
+    Archetype::get_mask() const {
+        return mask;
+    }
+
+    inline int
+    Archetype::get_column(int component_type_id) const {
+        return column_of[component_type_id];
+    }
+
+    inline int
+    Archetype::get_column_count() const {
+        return static_cast<int>(column_infos.size());
+    }
+
+    inline const Component_Info&
+    Archetype::get_column_info(int column) const {
+        return *column_infos[column];
+    }
+
+    inline int
+    Archetype::get_chunk_count() const {
+        return static_cast<int>(chunks.size());
+    }
+
+    inline int
+    Archetype::get_entity_count() const {
+        return entity_count;
+    }
+
+    inline Archetype_Chunk&
+    Archetype::get_chunk(int chunk) {
+        return *chunks[chunk];
+    }
+
+    inline int*
+    Archetype::get_entity_ids(int chunk) {
+        // Entity ids are always the first column:
+        return reinterpret_cast<int*>(chunks[chunk]->bytes);
+    }
+
+    inline u8*
+    Archetype::get_column_data(int chunk, int column) {
+        return chunks[chunk]->bytes + column_offsets[column];
+    }
+
+    /*
+    ## Archetype_Column: template implementations
+    */
+
+    template <typename T>
+    Archetype_Column<T>::Archetype_Column(Archetype_Storage* storage)
+    : storage(storage) {
+    }
+
+    template <typename T>
+    bool
+    Archetype_Column<T>::contains(int entity_id) const {
+        return storage->contains<T>(entity_id);
+    }
+
+    template <typename T>
+    T&
+    Archetype_Column<T>::get(int entity_id) {
+        return storage->get<T>(entity_id);
+    }
+
+    template <typename T>
+    const T&
+    Archetype_Column<T>::get(int entity_id) const {
+        return std::as_const(*storage).template get<T>(entity_id);
+    }
+
+    /*
+    ## Archetype_Storage: template implementations
+    */
+
+    inline Entity_Location&
+    Archetype_Storage::get_location(int entity_id) {
+        if (entity_id >= static_cast<int>(locations.size())) {
+            locations.resize(entity_id + 1);
+        }
+
+        return locations[entity_id];
+    }
+
+    template <typename T, typename ...T_Args>
+    T&
+    Archetype_Storage::emplace(int entity_id, T_Args&& ...args) {
+        const Component_Info& info = Component<T>::get_info();
+        register_component(info);
+
+        // Replace the existing component, { get } marks it:
+        if (contains<T>(entity_id)) {
+            T& component = get<T>(entity_id);
+            component    = T(std::forward<T_Args>(args)...);
+            return component;
+        }
+
+        mark_changed(info.type_id, entity_id);
+
+        // Move to the archetype which has { T } and construct it in the new row:
+        const Entity_Location& location = get_location(entity_id);
+        Component_Mask mask = location.archetype >= 0 ? archetypes[location.archetype]->get_mask() : Component_Mask();
+        mask.set(info.type_id);
+
+        move_entity(entity_id, find_or_create_archetype(mask));
+
+        const Entity_Location& new_location = locations[entity_id];
+        Archetype& archetype = *archetypes[new_location.archetype];
+        u8* column           = archetype.get_column_data(new_location.chunk, archetype.get_column(info.type_id));
+
+        return *new (column + new_location.row * sizeof(T)) T(std::forward<T_Args>(args)...);
+    }
+
+    template <typename T>
+    void
+    Archetype_Storage::remove(int entity_id) {
+        if (!contains<T>(entity_id)) {
+            return;
+        }
+
+        const Entity_Location& location = locations[entity_id];
+        Component_Mask mask = archetypes[location.archetype]->get_mask();
+        mask.remove<T>();
+
+        // Entities without components do not belong to any archetype:
+        if (mask == Component_Mask()) {
+            remove_entity(entity_id);
+        } else {
+            move_entity(entity_id, find_or_create_archetype(mask));
+        }
+    }
+
+    template <typename T>
+    bool
+    Archetype_Storage::contains(int entity_id) const {
+        if (entity_id >= static_cast<int>(locations.size()) || locations[entity_id].archetype < 0) {
+            return false;
+        }
+
+        return archetypes[locations[entity_id].archetype]->get_mask().has<T>();
+    }
+
+    template <typename T>
+    T&
+    Archetype_Storage::get(int entity_id) {
+        mark_changed(Component<T>::get_type_id(), entity_id);
+        return const_cast<T&>(std::as_const(*this).template get<T>(entity_id));
+    }
+
+    template <typename T>
+    const T&
+    Archetype_Storage::get(int entity_id) const {
+        const Entity_Location& location = locations[entity_id];
+        Archetype& archetype            = *archetypes[location.archetype];
+
+        const int column = archetype.get_column(Component<T>::get_type_id());
+        EXPECT(column != Archetype::NO_COLUMN, "Entity does not have this component!");
+
+        return reinterpret_cast<T*>(archetype.get_column_data(location.chunk, column))[location.row];
+    }
+
+    template <typename T>
+    Archetype_Column<T>&
+    Archetype_Storage::get_column() {
+        const int component_type_id = Component<T>::get_type_id();
+        if (component_type_id >= static_cast<int>(columns.size())) {
+            columns.resize(component_type_id + 1);
+        }
+
+        if (columns[component_type_id] == nullptr) {
+            columns[component_type_id] = std::make_unique<Archetype_Column<T>>(this);
+        }
+
+        return *static_cast<Archetype_Column<T>*>(columns[component_type_id].get());
+    }
+
+    /*
+    ## Archetype_View: template implementations
+    */
+
+    template <typename ...Ts>
+    Archetype_View<Ts...>::Archetype_View(Archetype_Storage& storage, const std::vector<Entity>& entity_slots)
+    : storage(storage), entity_slots(entity_slots) {
+        (mask.add<std::remove_const_t<Ts>>(), ...);
+    }
+
+    template <typename ...Ts>
+    template <typename T_Fn>
+    void
+    Archetype_View<Ts...>::each_chunk(T_Fn&& fn) {
+        each_chunk_columns(fn, std::index_sequence_for<Ts...>());
+    }
+
+    template <typename ...Ts>
+    template <typename T_Fn, size_t ...I>
+    void
+    Archetype_View<Ts...>::each_chunk_columns(T_Fn& fn, std::index_sequence<I...>) {
+        for (int index = 0; index < storage.get_archetype_count(); index++) {
+            Archetype& archetype = storage.get_archetype(index);
+            if (!archetype.get_mask().contains(mask)) {
+                continue;
+            }
+
+            // Column lookups happen once per archetype, not per entity:
+            const int columns[] = { archetype.get_column(Component<std::remove_const_t<Ts>>::get_type_id())... };
+
+            for (int chunk = 0; chunk < archetype.get_chunk_count(); chunk++) {
+                fn(
+                    archetype.get_chunk(chunk).count,
+                    archetype.get_entity_ids(chunk),
+                    reinterpret_cast<Ts*>(archetype.get_column_data(chunk, columns[I]))...
+                );
+            }
+        }
+    }
+
+    template <typename ...Ts>
+    template <typename T_Fn>
+    void
+    Archetype_View<Ts...>::each(T_Fn&& fn) {
+        each_chunk([&](int count, const int* entity_ids, Ts* ...column_data) {
+            for (int row = 0; row < count; row++) {
+                fn(entity_slots[entity_ids[row]], column_data[row]...);
+                (mark_changed<Ts>(entity_ids[row]), ...);
+            }
+        });
+    }
+
+    template <typename ...Ts>
+    template <typename T>
+    void
+    Archetype_View<Ts...>::mark_changed(int entity_id) {
+        // Read only components keep their tick:
+        if constexpr (!std::is_const_v<T>) {
+            storage.mark_changed(Component<T>::get_type_id(), entity_id);
+        }
+    }
+
+    template <typename ...Ts>
+    int
+    Archetype_View<Ts...>::size_hint() const {
+        int count = 0;
+        for (int index = 0; index < storage.get_archetype_count(); index++) {
+            Archetype& archetype = storage.get_archetype(index);
+            if (archetype.get_mask().contains(mask)) {
+                count += archetype.get_entity_count();
+            }
+        }
+
+        return count;
+    }
+
+} // jbx
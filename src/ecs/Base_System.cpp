@@ -2,6 +2,9 @@
 // Implements:
 #include <ecs/Base_System.hpp>
 
+// Dependencies (3rd party):
+#include <utility>
+
 namespace jbx {
 
     /*
@@ -10,20 +13,63 @@ namespace jbx {
 
     void
     Base_System::add_entity(Entity entity) {
+        if (entity_indices.contains(entity.id)) {
+            return;
+        }
+
+        entity_indices.insert(entity.id);
         entities.push_back(entity);
+        on_entity_added(entity);
     }
 
     void
     Base_System::remove_entity(Entity entity) {
-        for (auto it = entities.begin(); it != entities.end();) {
-            Entity& current = *it;
-            if (current == entity) {
-                it = entities.erase(it);
-                break;
-            } else {
-                it += 1;
-            }
+        if (!entity_indices.contains(entity.id)) {
+            return;
         }
+
+        // Mirror the swap done by the sparse set:
+        const int index_of_removed = entity_indices.swap_remove(entity.id);
+        entities[index_of_removed] = entities.back();
+        entities.pop_back();
+
+        if (entity_indices.is_oversized()) {
+            entity_indices.shrink_to_fit();
+            entities.shrink_to_fit();
+        }
+
+        on_entity_removed(entity);
+    }
+
+    bool
+    Base_System::has_entity(Entity entity) const {
+        return entity_indices.contains(entity.id);
+    }
+
+    const std::vector<Entity>&
+    Base_System::get_entities() const {
+        return entities;
+    }
+
+    u64
+    Base_System::get_memory_bytes() const {
+        return entities.capacity() * sizeof(Entity) + entity_indices.get_dense_bytes() + entity_indices.get_sparse_bytes();
+    }
+
+    void
+    Base_System::release_empty_pages() {
+        entity_indices.release_empty_pages();
+    }
+
+    int
+    Base_System::index_of(int entity_id) const {
+        return entity_indices.index_of(entity_id);
+    }
+
+    void
+    Base_System::swap_indices(int index_a, int index_b) {
+        entity_indices.swap_indices(index_a, index_b);
+        std::swap(entities[index_a], entities[index_b]);
     }
 
     const Component_Mask&
@@ -31,4 +77,63 @@ namespace jbx {
         return component_mask;
     }
 
+    bool
+    Base_System::conflicts_with(const Base_System& other) const {
+        const Component_Mask no_access;
+
+        // Undeclared access means we know nothing, so it has to be exclusive:
+        const bool declared       = read_mask != no_access || write_mask != no_access;
+        const bool other_declared = other.read_mask != no_access || other.write_mask != no_access;
+        if (!declared || !other_declared) {
+            return true;
+        }
+
+        return write_mask.intersects(other.read_mask) ||
+               write_mask.intersects(other.write_mask) ||
+               other.write_mask.intersects(read_mask);
+    }
+
+    System_Phase
+    Base_System::get_phase() const {
+        return phase;
+    }
+
+    System_Flags
+    Base_System::get_flags() const {
+        return flags;
+    }
+
+    u32
+    Base_System::get_command_scope() const {
+        return command_scope;
+    }
+
+    void
+    Base_System::set_command_scope(u32 scope) {
+        command_scope = scope;
+    }
+
+    void
+    Base_System::set_registry(Registry* owner) {
+        registry = owner;
+    }
+
+    u32
+    Base_System::get_last_run_tick() const {
+        return last_run_tick;
+    }
+
+    void
+    Base_System::set_last_run_tick(u32 tick) {
+        last_run_tick = tick;
+    }
+
+    void
+    Base_System::on_entity_added(Entity) {
+    }
+
+    void
+    Base_System::on_entity_removed(Entity) {
+    }
+
 }
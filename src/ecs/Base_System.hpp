@@ -3,36 +3,268 @@
 
 #include <ecs/Component.hpp>
 #include <ecs/Entity.hpp>
+#include <ecs/Sparse_Set.hpp>
+#include <ecs/Command_Buffer.hpp>
+#include <engine/core/job_system.hpp>
 
 namespace jbx {
 
+   class Registry;
+
+   /*
+       Point of the frame at which the system runs, see { Registry::run_systems }:
+       - { System_Phase_Update }: simulation, runs after the frontend step.
+       - { System_Phase_Render }: draws into the 2D scene.
+   */
+   enum System_Phase : u8 {
+       System_Phase_Update = 0,
+       System_Phase_Render,
+       System_Phase_Count
+   };
+
+   /*
+       Flags used to configure how the system is scheduled:
+       - { System_Flags_None }:        Nothing.
+       - { System_Flags_Main_Thread }: System must run on the main thread, e.g. it submits draw calls.
+   */
+   typedef u8 System_Flags;
+   enum System_Flags_ : u8 {
+       System_Flags_None        = 0,        // 0000 0000
+       System_Flags_Main_Thread = 1 << 0    // 0000 0001
+   };
+
    /*
        A system simply keeps a collection of all the entities which meet the component
        requirements.
 
        { Base_System } is purposefully open-ended to enable systems to be used in different ways
        or different parts of the life-cycle.
+
+       Membership is maintained by the { Registry } whenever the mask of an entity changes, { entity_indices }
+       maps entity ids into { entities } so adding and removing is O(1), removal swaps the last entity into
+       the removed slot.
+
+       Systems declare which components they { reads<T>() } and { writes<T>() } in the constructor, systems
+       of the same phase whose declarations do not conflict may run at the same time on different threads.
+       A system which declares nothing is assumed to write everything and always runs alone.
+
+       Systems can split { entities } into batches which run on the { Job_System } with { parallel_for_each }
+       and { parallel_reduce }, see below.
+
+       Systems reach the components through { registry }, the one which owns them, so there may be more than
+       one { Registry } per process, see { Engine_Instance }.
    */
    class Base_System {
    protected:
+       Registry*            registry = nullptr;
        Component_Mask       component_mask;
        std::vector<Entity>  entities;
+       Sparse_Set           entity_indices;
+
+       Component_Mask       read_mask;
+       Component_Mask       write_mask;
+       System_Phase         phase = System_Phase_Update;
+       System_Flags         flags = System_Flags_None;
+       u32                  command_scope = 0;
+       u32                  last_run_tick = 0;
 
    public:
        Base_System()          = default;
        virtual ~Base_System() = default;
 
+       /*
+           Add the entity, does nothing if the system already has it.
+       */
        void
        add_entity(Entity entity);
 
+       /*
+           Remove the entity, does nothing if the system does not have it.
+       */
        void
        remove_entity(Entity entity);
 
+       bool
+       has_entity(Entity entity) const;
+
+       const std::vector<Entity>&
+       get_entities() const;
+
+       /*
+           Memory held by { entities } and { entity_indices }, in bytes.
+       */
+       u64
+       get_memory_bytes() const;
+
+       /*
+           Free the sparse pages of { entity_indices } which no entity of the system is on.
+       */
+       void
+       release_empty_pages();
+
+       /*
+           Index of the entity in { entities }, or { Sparse_Set::INVALID_INDEX }.
+       */
+       int
+       index_of(int entity_id) const;
+
+       /*
+           Exchange the entities at the two indices, used to line { entities } up with the pools, see
+           { Registry::set_pool_order }.
+       */
+       void
+       swap_indices(int index_a, int index_b);
+
        const Component_Mask&
        get_component_mask() const;
 
+       /*
+           Check if this system may not run at the same time as the other one, i.e. one of them writes a
+           component the other one reads or writes.
+       */
+       bool
+       conflicts_with(const Base_System& other) const;
+
+       System_Phase
+       get_phase() const;
+
+       System_Flags
+       get_flags() const;
+
+       /*
+           Order of the commands this system records relative to other systems, see { Command_Order_Scope }.
+           Assigned by the { Registry } when the system is added.
+       */
+       u32
+       get_command_scope() const;
+
+       void
+       set_command_scope(u32 scope);
+
+       /*
+           Set by the { Registry } when the system is added.
+       */
+       void
+       set_registry(Registry* owner);
+
+       /*
+           Change tick of the previous run of the system, pass it to { Registry::each_changed } to visit
+           only the components which changed since. 0 before the first run, so everything counts as changed.
+       */
+       u32
+       get_last_run_tick() const;
+
+       void
+       set_last_run_tick(u32 tick);
+
        virtual void
        update(f64 delta_time) = 0;
+
+   protected:
+       /*
+           Called by { add_entity } and { remove_entity } when the entity actually joins or leaves the system,
+           for systems which keep their own structures over { entities }, e.g. { Spatial_Index_System }.
+       */
+       virtual void
+       on_entity_added(Entity entity);
+
+       virtual void
+       on_entity_removed(Entity entity);
+
+       template <typename T>
+       void
+       reads();
+
+       template <typename T>
+       void
+       writes();
+
+       /*
+           Default number of entities per batch, the handles of a batch take 32 KiB and the components of a
+           batch touched by a typical system fit into L2.
+       */
+       static constexpr int DEFAULT_BATCH_SIZE = 4096;
+
+       /*
+           Call { fn(Entity) } for every entity, batches of { batch_size } entities run in parallel.
+
+           The { fn } may only write the components of the entity it was given, which the system declared with
+           { writes<T>() }. Structural changes (add or remove components, create or kill entities) must go
+           through { Registry::get_commands }, they are ordered by entity index. Storage must be resolved
+           before, since { Registry::get_storage } may create it.
+       */
+       template <typename T_Fn>
+       void
+       parallel_for_each(T_Fn&& fn, int batch_size = DEFAULT_BATCH_SIZE);
+
+       /*
+           Same as { parallel_for_each }, but every batch accumulates into its own { T } which starts as
+           { identity }, with { map(Entity, T& accumulator) }. Accumulators are then combined with
+           { reduce(T, T) } in batch order, so the result does not depend on the number of threads or on
+           which batch finished first.
+       */
+       template <typename T, typename T_Map, typename T_Reduce>
+       T
+       parallel_reduce(T identity, T_Map&& map, T_Reduce&& reduce, int batch_size = DEFAULT_BATCH_SIZE);
    };
 
+   /*
+   ## Base_System: template implementations
+   */
+
+   template <typename T>
+   void
+   Base_System::reads() {
+       read_mask.add<T>();
+   }
+
+   template <typename T>
+   void
+   Base_System::writes() {
+       write_mask.add<T>();
+   }
+
+   template <typename T_Fn>
+   void
+   Base_System::parallel_for_each(T_Fn&& fn, int batch_size) {
+       const Entity* batch_entities = entities.data();
+       const int entity_count       = static_cast<int>(entities.size());
+
+       get_context<Job_System>()->parallel_for(0, entity_count, batch_size, [&](int begin, int end) {
+           for (int i = begin; i < end; i++) {
+               Command_Order_Scope order(command_scope, static_cast<u32>(i) + 1);
+               fn(batch_entities[i]);
+           }
+       });
+   }
+
+   template <typename T, typename T_Map, typename T_Reduce>
+   T
+   Base_System::parallel_reduce(T identity, T_Map&& map, T_Reduce&& reduce, int batch_size) {
+       const int entity_count = static_cast<int>(entities.size());
+       if (batch_size <= 0) {
+           batch_size = DEFAULT_BATCH_SIZE;
+       }
+
+       // One accumulator per batch, the batches are fixed by { batch_size } alone:
+       const int batch_count = (entity_count + batch_size - 1) / batch_size;
+       std::vector<T> accumulators(batch_count, identity);
+       const Entity* batch_entities = entities.data();
+
+       get_context<Job_System>()->parallel_for(0, entity_count, batch_size, [&](int begin, int end) {
+           T& accumulator = accumulators[begin / batch_size];
+           for (int i = begin; i < end; i++) {
+               Command_Order_Scope order(command_scope, static_cast<u32>(i) + 1);
+               map(batch_entities[i], accumulator);
+           }
+       });
+
+       T result = identity;
+       for (T& accumulator: accumulators) {
+           result = reduce(result, accumulator);
+       }
+
+       return result;
+   }
+
 } // jbx
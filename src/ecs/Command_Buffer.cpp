@@ -0,0 +1,126 @@
+
+// Implements:
+#include <ecs/Command_Buffer.hpp>
+
+namespace jbx {
+
+    /*
+        Order key of the calling thread, see { Command_Order_Scope }.
+    */
+    static thread_local u64 current_order = 0;
+
+    /*
+    ## Command: implementation
+    */
+
+    void*
+    Command::get_payload() {
+        return reinterpret_cast<u8*>(this) + sizeof(Command);
+    }
+
+    const void*
+    Command::get_payload() const {
+        return reinterpret_cast<const u8*>(this) + sizeof(Command);
+    }
+
+    /*
+    ## Command_Buffer: implementation
+    */
+
+    Command_Buffer::Command_Buffer(int buffer_index)
+    : buffer_index(buffer_index) {
+    }
+
+    Command&
+    Command_Buffer::push(Command_Type type, Entity entity, int payload_size) {
+        // Keep every command 16 byte aligned:
+        const int size = (static_cast<int>(sizeof(Command)) + payload_size + 15) & ~15;
+
+        // Move on to the next block, or allocate a new one, when the current one is full:
+        while (current_block < static_cast<int>(blocks.size()) &&
+               blocks[current_block].used + size > blocks[current_block].capacity) {
+            current_block += 1;
+        }
+
+        if (current_block == static_cast<int>(blocks.size())) {
+            const int capacity = std::max(BLOCK_SIZE, size);
+            blocks.push_back({ std::make_unique<u8[]>(capacity), capacity, 0 });
+        }
+
+        Block& block     = blocks[current_block];
+        Command* command = new (block.bytes.get() + block.used) Command {
+            Command_Order_Scope::get_current_order(),
+            entity,
+            nullptr,
+            static_cast<u32>(size),
+            type
+        };
+        block.used += size;
+
+        return *command;
+    }
+
+    Entity
+    Command_Buffer::spawn() {
+        // Placeholders count down from -2, -1 is the null entity. Generation holds the buffer:
+        const Entity placeholder(-(spawn_count + 2), static_cast<u32>(buffer_index));
+        spawn_count += 1;
+
+        push(Command_Type_Spawn, placeholder, 0);
+        return placeholder;
+    }
+
+    void
+    Command_Buffer::kill(Entity entity) {
+        push(Command_Type_Kill, entity, 0);
+    }
+
+    void
+    Command_Buffer::reset() {
+        for (Block& block: blocks) {
+            block.used = 0;
+        }
+
+        current_block = 0;
+        spawn_count   = 0;
+    }
+
+    int
+    Command_Buffer::get_buffer_index() const {
+        return buffer_index;
+    }
+
+    int
+    Command_Buffer::get_spawn_count() const {
+        return spawn_count;
+    }
+
+    bool
+    Command_Buffer::is_placeholder(Entity entity) {
+        return entity.id < -1;
+    }
+
+    int
+    Command_Buffer::get_placeholder_index(Entity entity) {
+        return -entity.id - 2;
+    }
+
+    /*
+    ## Command_Order_Scope: implementation
+    */
+
+    Command_Order_Scope::Command_Order_Scope(u32 scope, u32 item)
+    : previous_order(current_order) {
+        current_order = (static_cast<u64>(scope) << 32) | item;
+    }
+
+    Command_Order_Scope::~Command_Order_Scope() {
+        current_order = previous_order;
+    }
+
+    u64
+    Command_Order_Scope::get_current_order() {
+        return current_order;
+    }
+
+} // jbx
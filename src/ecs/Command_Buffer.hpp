@@ -0,0 +1,161 @@
+
+#pragma once
+
+#include <ecs/Entity.hpp>
+
+// Dependencies (3rd party):
+#include <type_traits>
+
+namespace jbx {
+
+    class Registry;
+
+    enum Command_Type : u8 {
+        Command_Type_Spawn = 0,
+        Command_Type_Kill,
+        Command_Type_Add_Component,
+        Command_Type_Remove_Component
+    };
+
+    /*
+        A recorded structural change, the component (if any) is stored right after the command.
+        - { order }:  playback key, see { Command_Order_Scope }.
+        - { apply }:  adds or removes the component, resolved when the command is recorded.
+        - { size }:   size of the command including the payload, used to walk the arena.
+    */
+    struct alignas(16) Command {
+        u64            order;
+        Entity         entity;
+        void         (*apply)(Registry& registry, Entity entity, const void* payload);
+        u32            size;
+        Command_Type   type;
+
+        void*
+        get_payload();
+
+        const void*
+        get_payload() const;
+    };
+
+    /*
+        { Command_Buffer } records structural changes made from any thread, so they can be applied later by the
+        { Registry } at a single sync point, see { Registry::get_commands }.
+
+        Commands are written into blocks of arena memory with a bump pointer and the blocks are kept between
+        frames, so recording does not allocate once the arena has grown to the size of a frame. Components
+        are copied into the arena, which is why they must be trivially copyable.
+
+        Entities spawned through the buffer get a placeholder handle (negative id), which can be used with
+        the other commands of the same buffer and is replaced with the real entity during playback.
+    */
+    class Command_Buffer final {
+    private:
+        static constexpr int BLOCK_SIZE = 64 * 1024;
+
+        struct Block {
+            Unique<u8[]> bytes;
+            int          capacity;
+            int          used;
+        };
+
+        std::vector<Block> blocks;
+        int                current_block = 0;
+        int                buffer_index;
+        int                spawn_count   = 0;
+
+    public:
+        explicit Command_Buffer(int buffer_index);
+
+        /*
+            Create an entity during playback, returns a placeholder for it.
+        */
+        Entity
+        spawn();
+
+        void
+        kill(Entity entity);
+
+        template <typename T_Component>
+        void
+        add_component(Entity entity, const T_Component& component);
+
+        template <typename T_Component>
+        void
+        remove_component(Entity entity);
+
+        /*
+            Call { fn(const Command&) } for every command, in the order they were recorded.
+        */
+        template <typename T_Fn>
+        void
+        for_each(T_Fn&& fn) const;
+
+        /*
+            Forget every command, but keep the memory.
+        */
+        void
+        reset();
+
+        int
+        get_buffer_index() const;
+
+        int
+        get_spawn_count() const;
+
+        static bool
+        is_placeholder(Entity entity);
+
+        /*
+            Index of the spawn command in the buffer which created the placeholder.
+        */
+        static int
+        get_placeholder_index(Entity entity);
+
+    private:
+        Command&
+        push(Command_Type type, Entity entity, int payload_size);
+    };
+
+    /*
+        Commands are played back sorted by an order key, so the result does not depend on which thread
+        recorded them. The key is { scope } (e.g. the system) in the high bits and { item } (e.g. the entity
+        index) in the low bits, set for the calling thread while the scope object is alive.
+
+        Commands with the same key keep the order they were recorded in, across buffers they are ordered
+        by the buffer index.
+    */
+    class Command_Order_Scope final {
+    private:
+        u64 previous_order;
+
+    public:
+        Command_Order_Scope(u32 scope, u32 item);
+        ~Command_Order_Scope();
+
+        Command_Order_Scope(const Command_Order_Scope&)            = delete;
+        Command_Order_Scope& operator=(const Command_Order_Scope&) = delete;
+
+        static u64
+        get_current_order();
+    };
+
+    /*
+    ## Command_Buffer: template implementations
+
+        { apply } functions are defined in { Registry.hpp }, they need the complete { Registry } type.
+    */
+
+    template <typename T_Fn>
+    void
+    Command_Buffer::for_each(T_Fn&& fn) const {
+        // Blocks after the current one are empty:
+        for (const Block& block: blocks) {
+            for (int offset = 0; offset < block.used;) {
+                const Command& command = *reinterpret_cast<const Command*>(block.bytes.get() + offset);
+                fn(command);
+                offset += command.size;
+            }
+        }
+    }
+
+} // jbx
@@ -1,18 +1,104 @@
 
 #pragma once
 
+// Dependencies (3rd party):
+#include <immintrin.h>
+#if defined(_MSC_VER)
+    #include <intrin.h> // _BitScanForward64
+#endif
+
+/*
+    Number of unique component types the ECS can handle, set with the { PROJECT_ECS_MAX_COMPONENT_TYPES } CMake
+    option. Must be a multiple of 64.
+*/
+#ifndef PROJECT_ECS_MAX_COMPONENT_TYPES
+    #define PROJECT_ECS_MAX_COMPONENT_TYPES 64
+#endif
+
 namespace jbx {
+
+    constexpr int MAX_COMPONENT_TYPES = PROJECT_ECS_MAX_COMPONENT_TYPES;
+
+    /*
+        Every component type has to be registered with a unique id, inside of { namespace jbx }:
+
+            REGISTER_COMPONENT(Rect, 0);
+
+        The id is the bit used in the { Component_Mask } and it's known at compile time, so it's the same in
+        every build and every process. Saved data depends on it, so never change or re-use an id.
+    */
+    template <typename T>
+    struct Component_Traits {
+        static constexpr int         id   = -1;
+        static constexpr const char* name = nullptr;
+    };
+
+    #define REGISTER_COMPONENT(type, type_id)               \
+        template <>                                         \
+        struct Component_Traits<type> {                     \
+            static constexpr int         id   = type_id;    \
+            static constexpr const char* name = #type;      \
+        }
+
     /*
-        { Component_Mask } is used to determine which components an entity has, or which
+        Type-erased description of a component type, used by storage which does not know { T } at the
+        point where components are moved around (e.g. { Archetype_Storage }).
+    */
+    struct Component_Info {
+        int         type_id;
+        const char* name;
+        int         size;
+        int         alignment;
+
+        // Move construct the object at { destination } from the one at { source }.
+        void (*move_construct)(void* destination, void* source);
+
+        // Call the destructor of the object.
+        void (*destroy)(void* object);
+    };
+
+    template <typename T>
+    class Component final {
+    public:
+        /*
+            This determines which bit in the { Component_Mask } is used represent the presence of this specific
+            component type { T }.
+        */
+        static constexpr int TYPE_ID = Component_Traits<T>::id;
+
+        static_assert(TYPE_ID >= 0, "Component type was not registered, see { REGISTER_COMPONENT }!");
+        static_assert(TYPE_ID < MAX_COMPONENT_TYPES, "Component id exceeds { PROJECT_ECS_MAX_COMPONENT_TYPES }!");
+
+        static constexpr int
+        get_type_id();
+
+        static constexpr const char*
+        get_name();
+
+        static const Component_Info&
+        get_info();
+    };
+
+    /*
+        { Basic_Component_Mask } is used to determine which components an entity has, or which
         components a system requires.
 
-        Bit size of the { value } member determines how many different components types can exist
-        at once. In order to increase the number of component types we can handle, simply change
-        the type of the value to that of a different size.
+        { N_Bits } determines how many different components types can exist at once, the bits are stored
+        in 64 bit words. Every operation is branch-free, { contains } uses a single SSE2/AVX2 test for
+        128 and 256 bit masks, so matching does not get slower as the number of component types grows.
+
+        Use the { Component_Mask } alias, its size is set by { PROJECT_ECS_MAX_COMPONENT_TYPES }.
     */
-    class Component_Mask final {
+    template <int N_Bits>
+    class Basic_Component_Mask final {
+    public:
+        static constexpr int BIT_COUNT  = N_Bits;
+        static constexpr int WORD_COUNT = N_Bits / 64;
+
+        static_assert(N_Bits > 0 && N_Bits % 64 == 0, "Component mask size must be a multiple of 64 bits!");
+
     private:
-        u8 value = 0;
+        alignas(WORD_COUNT >= 4 ? 32 : 16) u64 words[WORD_COUNT] = {};
 
     public:
         /*
@@ -34,10 +120,22 @@ namespace jbx {
         void remove();
 
         /*
-            Get the current mask value:
+            Same as { has, add, remove } but with the component type id.
         */
-        const u8
-        get_value() const;
+        bool
+        test(int component_type_id) const;
+
+        void
+        set(int component_type_id);
+
+        void
+        clear(int component_type_id);
+
+        /*
+            Get the word at the given index, bit { i } of the mask lives in word { i / 64 }.
+        */
+        u64
+        get_word(int index) const;
 
         /*
             Sets the value to 0, effectively removing all the components from the mask.
@@ -49,71 +147,243 @@ namespace jbx {
             Check if given { Component_Mask } is fully expressed in the current mask.
         */
         bool
-        contains(const Component_Mask& other) const;
+        contains(const Basic_Component_Mask& other) const;
+
+        /*
+            Check if the masks have at least one component in common.
+        */
+        bool
+        intersects(const Basic_Component_Mask& other) const;
+
+        /*
+            Call { fn(int component_type_id) } for every component in the mask, in ascending order.
+        */
+        template <typename T_Fn>
+        void
+        for_each(T_Fn&& fn) const;
+
+        Basic_Component_Mask
+        operator ^(const Basic_Component_Mask& other) const;
+
+        Basic_Component_Mask
+        operator &(const Basic_Component_Mask& other) const;
+
+        bool
+        operator ==(const Basic_Component_Mask& other) const;
+
+        bool
+        operator !=(const Basic_Component_Mask& other) const;
+
+        /*
+            Hash of the mask value, so it can be used as a key in unordered containers.
+        */
+        struct Hash {
+            size_t
+            operator ()(const Basic_Component_Mask& mask) const;
+        };
     };
 
-    constexpr int MAX_COMPONENT_TYPES = sizeof(Component_Mask) * 8;
+    typedef Basic_Component_Mask<MAX_COMPONENT_TYPES> Component_Mask;
 
     /*
-    ## Component_Mask: template definitions
+    ## Basic_Component_Mask: template definitions
     */
 
+    template <int N_Bits>
     template <typename T>
     bool
-    Component_Mask::has() const {
-        int component_type_id = Component<T>::get_type_id();
-        return (value & (1 << component_type_id)) != 0;
+    Basic_Component_Mask<N_Bits>::has() const {
+        return test(Component<T>::get_type_id());
     }
 
+    template <int N_Bits>
     template <typename T>
     void
-    Component_Mask::add() {
-        int component_type_id = Component<T>::get_type_id();
-        value |= (1 << component_type_id);
+    Basic_Component_Mask<N_Bits>::add() {
+        set(Component<T>::get_type_id());
     }
 
+    template <int N_Bits>
     template <typename T>
     void
-    Component_Mask::remove() {
-        int component_type_id = Component<T>::get_type_id();
-        value &= ~(1 << component_type_id);
+    Basic_Component_Mask<N_Bits>::remove() {
+        clear(Component<T>::get_type_id());
     }
 
+    template <int N_Bits>
+    inline bool
+    Basic_Component_Mask<N_Bits>::test(int component_type_id) const {
+        return (words[component_type_id >> 6] >> (component_type_id & 63)) & 1;
+    }
 
-    /*
-        Just an interface to make it possible to automatically generate unique id's for every component type.
+    template <int N_Bits>
+    inline void
+    Basic_Component_Mask<N_Bits>::set(int component_type_id) {
+        words[component_type_id >> 6] |= (1ull << (component_type_id & 63));
+    }
 
-        For this we use a dirty trick in the subclass - { Component } every generated version will increment the
-        { next_id } value by 1. One caveat here is that we cannot guarantee that a component type will have
-        the same ID every time, but that does not matter for our use case.
-    */
-    struct Base_Component {
-    protected:
-        static inline int next_id = 0;
-    };
+    template <int N_Bits>
+    inline void
+    Basic_Component_Mask<N_Bits>::clear(int component_type_id) {
+        words[component_type_id >> 6] &= ~(1ull << (component_type_id & 63));
+    }
 
-    template <typename T>
-    class Component final : public Base_Component {
-    public:
-        /*
-            This determines which bit in the { Component_Mask } is used represent the presence of this specific
-            component type { T }.
-        */
-        static int
-        get_type_id();
-    };
+    template <int N_Bits>
+    inline u64
+    Basic_Component_Mask<N_Bits>::get_word(int index) const {
+        return words[index];
+    }
+
+    template <int N_Bits>
+    inline void
+    Basic_Component_Mask<N_Bits>::reset() {
+        for (int i = 0; i < WORD_COUNT; i++) {
+            words[i] = 0;
+        }
+    }
+
+    template <int N_Bits>
+    inline bool
+    Basic_Component_Mask<N_Bits>::contains(const Basic_Component_Mask& other) const {
+        if constexpr (WORD_COUNT == 1) {
+            return (words[0] & other.words[0]) == other.words[0];
+        }
+    #if defined(__AVX2__)
+        else if constexpr (WORD_COUNT == 4) {
+            // { testc } sets the carry flag when (~value & other) == 0, which is exactly the subset test:
+            const __m256i value = _mm256_load_si256(reinterpret_cast<const __m256i*>(words));
+            const __m256i other_value = _mm256_load_si256(reinterpret_cast<const __m256i*>(other.words));
+            return _mm256_testc_si256(value, other_value) != 0;
+        }
+    #endif
+    #if defined(__SSE2__) || defined(_M_X64)
+        else if constexpr (WORD_COUNT % 2 == 0) {
+            // Compare (value & other) against other 128 bits at a time, accumulate without branching:
+            int equal_bytes = 0xFFFF;
+            for (int i = 0; i < WORD_COUNT; i += 2) {
+                const __m128i value = _mm_load_si128(reinterpret_cast<const __m128i*>(words + i));
+                const __m128i other_value = _mm_load_si128(reinterpret_cast<const __m128i*>(other.words + i));
+                const __m128i matched = _mm_cmpeq_epi8(_mm_and_si128(value, other_value), other_value);
+                equal_bytes &= _mm_movemask_epi8(matched);
+            }
+            return equal_bytes == 0xFFFF;
+        }
+    #endif
+        else {
+            u64 missing = 0;
+            for (int i = 0; i < WORD_COUNT; i++) {
+                missing |= (other.words[i] & ~words[i]);
+            }
+            return missing == 0;
+        }
+    }
+
+    template <int N_Bits>
+    inline bool
+    Basic_Component_Mask<N_Bits>::intersects(const Basic_Component_Mask& other) const {
+        u64 common = 0;
+        for (int i = 0; i < WORD_COUNT; i++) {
+            common |= (words[i] & other.words[i]);
+        }
+        return common != 0;
+    }
+
+    template <int N_Bits>
+    template <typename T_Fn>
+    inline void
+    Basic_Component_Mask<N_Bits>::for_each(T_Fn&& fn) const {
+        for (int i = 0; i < WORD_COUNT; i++) {
+            u64 word = words[i];
+            while (word != 0) {
+            #if defined(_MSC_VER)
+                unsigned long bit;
+                _BitScanForward64(&bit, word);
+            #else
+                const int bit = __builtin_ctzll(word);
+            #endif
+                fn(i * 64 + static_cast<int>(bit));
+
+                // Clear the lowest set bit:
+                word &= word - 1;
+            }
+        }
+    }
+
+    template <int N_Bits>
+    inline Basic_Component_Mask<N_Bits>
+    Basic_Component_Mask<N_Bits>::operator^(const Basic_Component_Mask& other) const {
+        Basic_Component_Mask result;
+        for (int i = 0; i < WORD_COUNT; i++) {
+            result.words[i] = words[i] ^ other.words[i];
+        }
+        return result;
+    }
+
+    template <int N_Bits>
+    inline Basic_Component_Mask<N_Bits>
+    Basic_Component_Mask<N_Bits>::operator&(const Basic_Component_Mask& other) const {
+        Basic_Component_Mask result;
+        for (int i = 0; i < WORD_COUNT; i++) {
+            result.words[i] = words[i] & other.words[i];
+        }
+        return result;
+    }
+
+    template <int N_Bits>
+    inline bool
+    Basic_Component_Mask<N_Bits>::operator==(const Basic_Component_Mask& other) const {
+        u64 difference = 0;
+        for (int i = 0; i < WORD_COUNT; i++) {
+            difference |= (words[i] ^ other.words[i]);
+        }
+        return difference == 0;
+    }
+
+    template <int N_Bits>
+    inline bool
+    Basic_Component_Mask<N_Bits>::operator!=(const Basic_Component_Mask& other) const {
+        return !(*this == other);
+    }
+
+    template <int N_Bits>
+    inline size_t
+    Basic_Component_Mask<N_Bits>::Hash::operator()(const Basic_Component_Mask& mask) const {
+        u64 hash = 14695981039346656037ull;
+        for (int i = 0; i < WORD_COUNT; i++) {
+            hash = (hash ^ mask.words[i]) * 1099511628211ull;
+        }
+        return static_cast<size_t>(hash);
+    }
 
     /*
     ## Component: template implementations
     */
 
     template <typename T>
-    int
+    constexpr int
     Component<T>::get_type_id() {
-        static const int id = next_id++;
-        ERROR_IF(id > MAX_COMPONENT_TYPES, "Maximum component count exceeded!");
+        return TYPE_ID;
+    }
 
-        return id;
+    template <typename T>
+    constexpr const char*
+    Component<T>::get_name() {
+        return Component_Traits<T>::name;
+    }
+
+    template <typename T>
+    const Component_Info&
+    Component<T>::get_info() {
+        static const Component_Info info = {
+            TYPE_ID,
+            get_name(),
+            static_cast<int>(sizeof(T)),
+            static_cast<int>(alignof(T)),
+            [](void* destination, void* source) { new (destination) T(std::move(*static_cast<T*>(source))); },
+            [](void* object) { static_cast<T*>(object)->~T(); }
+        };
+
+        return info;
     }
 
 } // jbx
@@ -122,10 +392,12 @@ namespace jbx {
 #if PROJECT_ENABLE_LOGS
     /*
         If logs are enabled make it easy for { fmt } and by extension { spdlog } to print out the Component_Mask
-        correctly.
+        correctly. Bits are printed most significant first, 64 per group, e.g. for 128 bits:
+
+        [0000...0000 0000...0101]
     */
-    template <>
-    struct fmt::formatter<jbx::Component_Mask> {
+    template <int N_Bits>
+    struct fmt::formatter<jbx::Basic_Component_Mask<N_Bits>> {
 
         inline constexpr auto
         parse(fmt::format_parse_context& ctx) {
@@ -134,18 +406,15 @@ namespace jbx {
 
         template <typename FormatContext>
         inline auto
-        format(const jbx::Component_Mask& mask, FormatContext& ctx) {
-            if constexpr (sizeof(jbx::Component_Mask) == 1) {        // 8 bits
-                return fmt::format_to(ctx.out(), "[{:08b}]", mask.get_value());
-            } if constexpr (sizeof(jbx::Component_Mask) == 2) {      // 16 bits
-                return fmt::format_to(ctx.out(), "[{:016b}]", mask.get_value());
-            } else if constexpr (sizeof(jbx::Component_Mask) == 4) { // 32 bits
-                return fmt::format_to(ctx.out(), "[{:032b}]", mask.get_value());
-            } else if constexpr (sizeof(jbx::Component_Mask) == 8) { // 64 bits
-                return fmt::format_to(ctx.out(), "[{:064b}]", mask.get_value());
-            } else {
-                ERROR_IF(true, "Formatter not implemented for { Component_Mask } of this capacity!");
+        format(const jbx::Basic_Component_Mask<N_Bits>& mask, FormatContext& ctx) const {
+            auto out = fmt::format_to(ctx.out(), "[");
+            for (int i = jbx::Basic_Component_Mask<N_Bits>::WORD_COUNT - 1; i >= 0; i--) {
+                out = fmt::format_to(out, "{:064b}", mask.get_word(i));
+                if (i > 0) {
+                    out = fmt::format_to(out, " ");
+                }
             }
+            return fmt::format_to(out, "]");
         }
 
     };
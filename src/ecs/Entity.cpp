@@ -5,17 +5,22 @@ namespace jbx {
 
     bool
     Entity::operator==(const Entity& other) const {
-        return id == other.id;
+        return id == other.id && generation == other.generation;
+    }
+
+    bool
+    Entity::operator!=(const Entity& other) const {
+        return !(*this == other);
     }
 
     bool
     Entity::operator<(const Entity& other) const {
-        return id < other.id;
+        return id < other.id || (id == other.id && generation < other.generation);
     }
 
     bool
     Entity::operator>(const Entity& other) const {
-        return id > other.id;
+        return other < *this;
     }
 
 } // jbx
@@ -4,18 +4,31 @@
 namespace jbx {
 
     /*
-        Entity is just an id.
+        Entity is just an id, paired with the generation of that id.
+
+        Ids are re-used once an entity is killed, every re-use increments the generation, so a handle kept
+        around after its entity was killed (e.g. in a script) will no longer compare equal to the new entity
+        with the same id, see { Registry::is_alive }.
+
+        { id } is the index into every per-entity array in the { Registry }.
     */
     struct Entity final {
         int id;
+        u32 generation;
 
-        Entity(int id): id(id) {}
+        Entity(int id, u32 generation = 0): id(id), generation(generation) {}
         Entity(const Entity& entity) = default;
         ~Entity()                    = default;
 
+        Entity&
+        operator =(const Entity& entity) = default;
+
         bool
         operator ==(const Entity& other) const;
 
+        bool
+        operator !=(const Entity& other) const;
+
         bool
         operator <(const Entity& other) const;
 
@@ -23,4 +36,6 @@ namespace jbx {
         operator >(const Entity& other) const;
     };
 
+    static_assert(sizeof(Entity) == 8, "Entity handle should pack into 64 bits!");
+
 } // jbx
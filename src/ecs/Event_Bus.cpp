@@ -0,0 +1,31 @@
+// Implements:
+#include <ecs/Event_Bus.hpp>
+
+namespace jbx {
+
+    /*
+    ## Event_Bus: implementation
+    */
+
+    Event_Bus::Event_Bus()
+    : thread_count(get_context<Job_System>()->get_thread_count()) {
+    }
+
+    void
+    Event_Bus::swap() {
+        for (Unique<Base_Event_Queue>& queue: queues) {
+            if (queue != nullptr) {
+                queue->swap();
+            }
+        }
+    }
+
+    int
+    Event_Bus::get_thread_index() const {
+        const int thread_index = get_context<Job_System>()->get_thread_index();
+        ERROR_IF(thread_index < 0, "Events sent from a thread which is not part of the { Job_System }!");
+
+        return thread_index;
+    }
+
+} // jbx
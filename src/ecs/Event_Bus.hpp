@@ -0,0 +1,295 @@
+
+#pragma once
+
+#include <engine/core/job_system.hpp>
+
+// Dependencies (3rd party):
+#include <atomic>
+#include <type_traits>
+
+namespace jbx {
+
+    /*
+        Read only view of the events of one type, contiguous in the order they were sent.
+    */
+    template <typename T>
+    struct Event_Span {
+        const T* data  = nullptr;
+        int      count = 0;
+
+        const T*
+        begin() const {
+            return data;
+        }
+
+        const T*
+        end() const {
+            return data + count;
+        }
+
+        int
+        size() const {
+            return count;
+        }
+
+        bool
+        empty() const {
+            return count == 0;
+        }
+
+        const T&
+        operator [](int index) const {
+            return data[index];
+        }
+    };
+
+    /*
+        Just an interface, so the { Event_Bus } can swap the queues of every event type without knowing { T }.
+    */
+    class Base_Event_Queue {
+    public:
+        virtual ~Base_Event_Queue() {}
+
+        /*
+            Make the events sent since the last swap readable, and forget the ones which were.
+        */
+        virtual void
+        swap() = 0;
+    };
+
+    /*
+        { Event_Queue } is double-buffered: events are written into { written } (one buffer per { Job_System }
+        thread, so sending never needs a lock or an atomic), and read from { readable }, which holds what was
+        sent before the last { swap }. Buffers keep their capacity, so a queue stops allocating once it has
+        grown to the size of a frame.
+    */
+    template <typename T>
+    class Event_Queue final : public Base_Event_Queue {
+    private:
+        // Threads push into their own buffer, keep them on separate cache lines:
+        struct alignas(64) Thread_Events {
+            std::vector<T> events;
+        };
+
+        std::vector<Thread_Events> written;
+        std::vector<T>             readable;
+
+    public:
+        explicit Event_Queue(int thread_count);
+
+        void
+        send(int thread_index, const T& event);
+
+        void
+        send(int thread_index, const T* events, int count);
+
+        Event_Span<T>
+        read() const;
+
+        /*
+            Buffers of the threads are joined in thread order, the order of events sent from a single thread
+            is kept. When only one thread sent anything the buffers are swapped instead of copied.
+        */
+        void
+        swap() override;
+    };
+
+    /*
+        { Event_Bus } lets systems (and the engine) tell each other what happened, without knowing about
+        each other or going through the frontend. Every event type has its own contiguous queue.
+
+        Usage:
+            event_bus.add_event_type<Contact>();               // Once, on the main thread.
+
+            event_bus.send(Contact { a, b });                  // From any { Job_System } thread.
+
+            for (const Contact& contact: event_bus.read<Contact>()) {
+                ...                                            // Everything sent before the last swap.
+            }
+
+        Events sent during a frame are read during the next one, { swap } is called once per frame by the
+        { Registry }, see { Registry::update }. Sending and reading are plain template calls, there is no
+        virtual call or { std::function } per event. Events are copied around in bulk, so they must be
+        trivially copyable.
+
+        Event types are numbered when they are first used, unlike component ids these are not saved
+        anywhere, so they may differ between runs.
+    */
+    class Event_Bus final {
+    private:
+        static inline std::atomic<int> event_type_count = 0;
+
+        std::vector<Unique<Base_Event_Queue>> queues;
+        int                                   thread_count;
+
+    public:
+        Event_Bus();
+        ~Event_Bus() = default;
+
+        /*
+            Create the queue of the event type, must be done on the main thread before the first event of the
+            type is sent. Adding a type twice does nothing.
+        */
+        template <typename T>
+        void
+        add_event_type();
+
+        /*
+            Send the event from the calling thread, which must be part of the { Job_System }.
+        */
+        template <typename T>
+        void
+        send(const T& event);
+
+        /*
+            Send { count } events at once, e.g. every result of a system.
+        */
+        template <typename T>
+        void
+        send(const T* events, int count);
+
+        /*
+            Events of the type which were sent before the last { swap }, valid until the next { swap }. Events
+            of types which were never added are empty.
+        */
+        template <typename T>
+        Event_Span<T>
+        read() const;
+
+        /*
+            Make every event sent since the last swap readable, must not run while events are sent.
+        */
+        void
+        swap();
+
+    private:
+        template <typename T>
+        static int
+        get_event_type_id();
+
+        template <typename T>
+        Event_Queue<T>&
+        get_queue();
+
+        int
+        get_thread_index() const;
+    };
+
+    /*
+    ## Event_Queue: template implementations
+    */
+
+    template <typename T>
+    Event_Queue<T>::Event_Queue(int thread_count)
+    : written(thread_count) {
+    }
+
+    template <typename T>
+    void
+    Event_Queue<T>::send(int thread_index, const T& event) {
+        written[thread_index].events.push_back(event);
+    }
+
+    template <typename T>
+    void
+    Event_Queue<T>::send(int thread_index, const T* events, int count) {
+        std::vector<T>& buffer = written[thread_index].events;
+        buffer.insert(buffer.end(), events, events + count);
+    }
+
+    template <typename T>
+    Event_Span<T>
+    Event_Queue<T>::read() const {
+        return Event_Span<T> { readable.data(), static_cast<int>(readable.size()) };
+    }
+
+    template <typename T>
+    void
+    Event_Queue<T>::swap() {
+        readable.clear();
+
+        // Find out if a single thread sent everything, the common case:
+        int sender_count = 0;
+        int last_sender  = 0;
+        for (int thread_index = 0; thread_index < static_cast<int>(written.size()); thread_index++) {
+            if (!written[thread_index].events.empty()) {
+                sender_count += 1;
+                last_sender   = thread_index;
+            }
+        }
+
+        if (sender_count == 1) {
+            std::swap(readable, written[last_sender].events);
+            return;
+        }
+
+        for (Thread_Events& thread_events: written) {
+            readable.insert(readable.end(), thread_events.events.begin(), thread_events.events.end());
+            thread_events.events.clear();
+        }
+    }
+
+    /*
+    ## Event_Bus: template implementations
+    */
+
+    template <typename T>
+    int
+    Event_Bus::get_event_type_id() {
+        static const int event_type_id = event_type_count.fetch_add(1);
+        return event_type_id;
+    }
+
+    template <typename T>
+    void
+    Event_Bus::add_event_type() {
+        static_assert(std::is_trivially_copyable_v<T>, "Events must be trivially copyable!");
+
+        const int event_type_id = get_event_type_id<T>();
+        if (event_type_id >= static_cast<int>(queues.size())) {
+            queues.resize(event_type_id + 1);
+        }
+
+        if (queues[event_type_id] == nullptr) {
+            queues[event_type_id] = std::make_unique<Event_Queue<T>>(thread_count);
+        }
+    }
+
+    template <typename T>
+    Event_Queue<T>&
+    Event_Bus::get_queue() {
+        const int event_type_id = get_event_type_id<T>();
+        ERROR_IF(
+            event_type_id >= static_cast<int>(queues.size()) || queues[event_type_id] == nullptr,
+            "Event type was not added, see { add_event_type }!"
+        );
+
+        return *static_cast<Event_Queue<T>*>(queues[event_type_id].get());
+    }
+
+    template <typename T>
+    void
+    Event_Bus::send(const T& event) {
+        get_queue<T>().send(get_thread_index(), event);
+    }
+
+    template <typename T>
+    void
+    Event_Bus::send(const T* events, int count) {
+        if (count > 0) {
+            get_queue<T>().send(get_thread_index(), events, count);
+        }
+    }
+
+    template <typename T>
+    Event_Span<T>
+    Event_Bus::read() const {
+        const int event_type_id = get_event_type_id<T>();
+        if (event_type_id >= static_cast<int>(queues.size()) || queues[event_type_id] == nullptr) {
+            return Event_Span<T>();
+        }
+
+        return static_cast<const Event_Queue<T>*>(queues[event_type_id].get())->read();
+    }
+
+} // jbx
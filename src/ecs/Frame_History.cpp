@@ -0,0 +1,383 @@
+
+// Implements:
+#include <ecs/Frame_History.hpp>
+
+// Dependencies (3rd party):
+#include <algorithm>
+
+namespace jbx {
+
+    /*
+    ## Frame_History: implementation
+    */
+
+    Frame_History::Frame_History(Registry& registry, int depth)
+    : registry(registry), depth(depth) {
+        ERROR_IF(depth <= 0, "Frame history needs room for at least one frame!");
+
+        frames.resize(depth);
+        buffers.resize(FIXED_SECTION_COUNT, std::vector<std::vector<u8>>(depth));
+        current.resize(FIXED_SECTION_COUNT);
+    }
+
+    u64
+    Frame_History::save() {
+        // Components which are not in the frame could not be restored:
+    #if PROJECT_ENABLE_LOGS && PROJECT_ECS_STORAGE_ARCHETYPES
+        Archetype_Storage& storage = registry.component_storage;
+        for (int index = 0; index < storage.get_archetype_count(); index++) {
+            const Archetype& archetype = storage.get_archetype(index);
+            ERROR_IF(
+                archetype.get_entity_count() > 0 && (archetype.get_mask() & tracked_mask) != archetype.get_mask(),
+                "Component type is in use, but not tracked by the { Frame_History }!"
+            );
+        }
+    #elif PROJECT_ENABLE_LOGS
+        for (int type_id = 0; type_id < MAX_COMPONENT_TYPES; type_id++) {
+            const Base_Pool* pool = registry.component_pools[type_id].get();
+            ERROR_IF(
+                pool != nullptr && pool->get_count() > 0 && !tracked_mask.test(type_id),
+                "Component type is in use, but not tracked by the { Frame_History }!"
+            );
+        }
+    #endif
+
+        read_registry();
+
+        // The new frame follows the current one, frames after it are dropped:
+        if (frame_count > 0) {
+            frame_count = current_frame - first_frame + 1;
+        }
+
+        if (frame_count == static_cast<u64>(depth)) {
+            drop_oldest_frame();
+        }
+
+        const u64 number = frame_count > 0 ? current_frame + 1 : first_frame;
+        const int slot   = get_slot(number);
+
+        // With a depth of 1 the previous frame is this one, every source is read before it's written:
+        const Frame* previous = frame_count > 0 ? &frames[get_slot(current_frame)] : nullptr;
+        Frame& frame          = frames[slot];
+        frame.sources.resize(get_section_count());
+
+        const bool same_structure = previous != nullptr && previous->structure_version == registry.structure_version;
+
+        for (int section = 0; section < get_section_count(); section++) {
+            const bool unchanged = previous != nullptr && (
+                (same_structure && is_structure_section(section)) || is_untouched(section) ||
+                matches(section, previous->sources[section])
+            );
+
+            if (unchanged) {
+                frame.sources[section] = previous->sources[section];
+                continue;
+            }
+
+            const Section_View& view = current[section];
+            std::vector<u8>& copy    = buffers[section][slot];
+
+            copy.resize(view.size);
+            if (view.size > 0) {
+                std::memcpy(copy.data(), view.data, view.size);
+            }
+
+            frame.sources[section] = slot;
+        }
+
+        frame.number            = number;
+        frame.structure_version = registry.structure_version;
+        frame.free_entity_id    = registry.free_entity_id;
+
+        frame_count  += 1;
+        current_frame = number;
+        current_tick  = registry.change_tick;
+
+        return number;
+    }
+
+    bool
+    Frame_History::restore(u64 frame_number) {
+        if (!has_frame(frame_number)) {
+            return false;
+        }
+
+        /*
+            Systems must agree with the masks before the entities are compared. Kills and commands recorded
+            since the last update were meant for the state which is replaced, they are dropped. Unlike
+            { Registry::update } this leaves the events, the change tick and the pool order alone.
+        */
+        registry.sync_systems();
+        registry.dead_entities.clear();
+        for (Unique<Command_Buffer>& buffer: registry.command_buffers) {
+            buffer->reset();
+        }
+
+        read_registry();
+
+        const Frame& frame         = frames[get_slot(frame_number)];
+        const Frame& current_state = frames[get_slot(current_frame)];
+        const bool same_structure  = registry.structure_version == frame.structure_version;
+
+        // Sections untouched since the current frame are the same as the frame's if they share the copy:
+        auto changed = [&](int section) {
+            if ((same_structure && is_structure_section(section)) ||
+                (is_untouched(section) && current_state.sources[section] == frame.sources[section])) {
+                return false;
+            }
+
+            return !matches(section, frame.sources[section]);
+        };
+
+        const bool groups_changed   = changed(SECTION_GROUPS);
+        const bool entities_changed = changed(SECTION_ENTITIES) || changed(SECTION_MASKS);
+
+        if (entities_changed) {
+            restore_entities(frame);
+        }
+
+        registry.free_entity_id = frame.free_entity_id;
+
+        if (groups_changed) {
+            const std::vector<u8>& copy = buffers[SECTION_GROUPS][frame.sources[SECTION_GROUPS]];
+            const int* entity_groups    = reinterpret_cast<const int*>(copy.data());
+
+            registry.entity_groups.assign(entity_groups, entity_groups + copy.size() / sizeof(int));
+            registry.rebuild_group_members();
+        }
+
+        // Rows of entities which moved to another archetype are not constructed, they must all be written:
+    #if PROJECT_ECS_STORAGE_ARCHETYPES
+        const bool rows_changed = entities_changed;
+    #else
+        const bool rows_changed = false;
+    #endif
+
+        bool same_ids = true;
+        for (int index = 0; index < static_cast<int>(tracked_components.size()); index++) {
+            const int ids_section        = FIXED_SECTION_COUNT + 2 * index;
+            const int components_section = ids_section + 1;
+
+            const bool ids_changed        = rows_changed || changed(ids_section);
+            const bool components_changed = changed(components_section);
+            same_ids = same_ids && !ids_changed;
+            if (!ids_changed && !components_changed) {
+                continue;
+            }
+
+            const std::vector<u8>& ids        = buffers[ids_section][frame.sources[ids_section]];
+            const std::vector<u8>& components = buffers[components_section][frame.sources[components_section]];
+
+            tracked_components[index].write(
+                registry,
+                reinterpret_cast<const int*>(ids.data()),
+                components.data(),
+                static_cast<int>(ids.size() / sizeof(int)),
+                ids_changed
+            );
+        }
+
+        /*
+            Pools are restored in the order of the frame, archetypes are written in the order of their rows.
+            Unless every id matched, the ids of the registry differ from the frame and it needs a new version:
+        */
+    #if PROJECT_ECS_STORAGE_ARCHETYPES
+        if (!same_ids) {
+            registry.change_structure();
+        } else {
+            registry.structure_version = frame.structure_version;
+        }
+    #else
+        registry.structure_version = frame.structure_version;
+    #endif
+
+        // Restored entities join and leave their systems right away:
+        registry.sync_systems();
+
+        current_frame = frame_number;
+        current_tick  = registry.change_tick;
+        return true;
+    }
+
+    void
+    Frame_History::restore_entities(const Frame& frame) {
+        const std::vector<u8>& slots_copy = buffers[SECTION_ENTITIES][frame.sources[SECTION_ENTITIES]];
+        const std::vector<u8>& masks_copy = buffers[SECTION_MASKS][frame.sources[SECTION_MASKS]];
+
+        const Entity* slots         = reinterpret_cast<const Entity*>(slots_copy.data());
+        const Component_Mask* masks = reinterpret_cast<const Component_Mask*>(masks_copy.data());
+
+        const int restored_count = static_cast<int>(slots_copy.size() / sizeof(Entity));
+        const int current_count  = static_cast<int>(registry.entity_slots.size());
+
+        for (int entity_id = 0; entity_id < std::max(restored_count, current_count); entity_id++) {
+            // Living entities are the ones whose slot points to itself:
+            const bool was_alive = entity_id < current_count && registry.entity_slots[entity_id].id == entity_id;
+            const bool is_alive  = entity_id < restored_count && slots[entity_id].id == entity_id;
+            if (!was_alive && !is_alive) {
+                continue;
+            }
+
+            const Component_Mask no_components;
+            const Component_Mask& mask          = was_alive ? registry.component_masks[entity_id] : no_components;
+            const Component_Mask& restored_mask = is_alive ? masks[entity_id] : no_components;
+
+            // Same entity, systems re-evaluate it in { update } if its components changed:
+            if (was_alive && is_alive && registry.entity_slots[entity_id] == slots[entity_id]) {
+                if (mask != restored_mask) {
+                    registry.mask_changes.push_back({ slots[entity_id], mask });
+
+                #if PROJECT_ECS_STORAGE_ARCHETYPES
+                    registry.component_storage.remove_entity(entity_id);
+                    if (restored_mask != no_components) {
+                        registry.component_storage.insert_entity(entity_id, restored_mask);
+                    }
+                #endif
+                }
+
+                continue;
+            }
+
+            // Otherwise the entity in the slot is replaced, the current one leaves its systems right away:
+            if (was_alive) {
+                const Entity entity = registry.entity_slots[entity_id];
+                for (auto& system: registry.systems) {
+                    if (mask.contains(system.second->get_component_mask())) {
+                        system.second->remove_entity(entity);
+                    }
+                }
+
+            #if PROJECT_ECS_STORAGE_ARCHETYPES
+                registry.component_storage.remove_entity(entity_id);
+            #endif
+            }
+
+            if (is_alive) {
+                registry.new_entities.push_back(slots[entity_id]);
+
+            #if PROJECT_ECS_STORAGE_ARCHETYPES
+                if (restored_mask != no_components) {
+                    registry.component_storage.insert_entity(entity_id, restored_mask);
+                }
+            #endif
+            }
+        }
+
+        registry.entity_slots.assign(slots, slots + restored_count);
+        registry.component_masks.assign(masks, masks + restored_count);
+    }
+
+    void
+    Frame_History::read_registry() {
+        current[SECTION_ENTITIES] = {
+            reinterpret_cast<const u8*>(registry.entity_slots.data()), sizeof(Entity) * registry.entity_slots.size()
+        };
+        current[SECTION_MASKS] = {
+            reinterpret_cast<const u8*>(registry.component_masks.data()), sizeof(Component_Mask) * registry.component_masks.size()
+        };
+        current[SECTION_GROUPS] = {
+            reinterpret_cast<const u8*>(registry.entity_groups.data()), sizeof(int) * registry.entity_groups.size()
+        };
+
+        for (int index = 0; index < static_cast<int>(tracked_components.size()); index++) {
+            Tracked_Component& tracked = tracked_components[index];
+            const int ids_section      = FIXED_SECTION_COUNT + 2 * index;
+
+            tracked.read(registry, tracked, current[ids_section], current[ids_section + 1]);
+        }
+    }
+
+    void
+    Frame_History::drop_oldest_frame() {
+        const int slot = get_slot(first_frame);
+
+        if (frame_count > 1) {
+            const int next_slot = get_slot(first_frame + 1);
+
+            for (int section = 0; section < get_section_count(); section++) {
+                if (frames[slot].sources[section] != slot || frames[next_slot].sources[section] != slot) {
+                    continue;
+                }
+
+                // The next frame has no copy of its own, it takes this one over (frames after it may use it too):
+                std::swap(buffers[section][slot], buffers[section][next_slot]);
+
+                for (u64 number = first_frame + 1; number < first_frame + frame_count; number++) {
+                    int& source = frames[get_slot(number)].sources[section];
+                    if (source == slot) {
+                        source = next_slot;
+                    }
+                }
+            }
+        }
+
+        first_frame += 1;
+        frame_count -= 1;
+    }
+
+    bool
+    Frame_History::matches(int section, int slot) const {
+        const std::vector<u8>& copy = buffers[section][slot];
+        const Section_View& view    = current[section];
+
+        return copy.size() == view.size && (view.size == 0 || std::memcmp(copy.data(), view.data, view.size) == 0);
+    }
+
+    bool
+    Frame_History::is_structure_section(int section) const {
+        return section < FIXED_SECTION_COUNT || (section - FIXED_SECTION_COUNT) % 2 == 0;
+    }
+
+    bool
+    Frame_History::is_untouched(int section) const {
+    #if PROJECT_ECS_STORAGE_ARCHETYPES
+        return false;
+    #else
+        if (is_structure_section(section) || frame_count == 0) {
+            return false;
+        }
+
+        if (registry.structure_version != frames[get_slot(current_frame)].structure_version) {
+            return false;
+        }
+
+        // Changes made in the tick of the save or restore may have come before it, they count as changes:
+        const int type_id     = tracked_components[(section - FIXED_SECTION_COUNT) / 2].info->type_id;
+        const Base_Pool* pool = registry.component_pools[type_id].get();
+        return pool == nullptr || pool->get_last_change_tick() < current_tick;
+    #endif
+    }
+
+    bool
+    Frame_History::has_frame(u64 frame) const {
+        return frame_count > 0 && frame >= first_frame && frame < first_frame + frame_count;
+    }
+
+    u64
+    Frame_History::get_oldest_frame() const {
+        EXPECT(frame_count > 0, "Frame history is empty!");
+        return first_frame;
+    }
+
+    u64
+    Frame_History::get_newest_frame() const {
+        EXPECT(frame_count > 0, "Frame history is empty!");
+        return first_frame + frame_count - 1;
+    }
+
+    int
+    Frame_History::get_depth() const {
+        return depth;
+    }
+
+    int
+    Frame_History::get_section_count() const {
+        return FIXED_SECTION_COUNT + 2 * static_cast<int>(tracked_components.size());
+    }
+
+    int
+    Frame_History::get_slot(u64 frame) const {
+        return static_cast<int>(frame % static_cast<u64>(depth));
+    }
+
+} // jbx
@@ -0,0 +1,298 @@
+
+#pragma once
+
+#include <ecs/Registry.hpp>
+
+// Dependencies (3rd party):
+#include <type_traits>
+#include <cstring>
+
+namespace jbx {
+
+    /*
+        { Frame_History } keeps the last { depth } states of a { Registry } in a ring of frames, for replay
+        scrubbing and rollback.
+
+        Usage:
+            Frame_History history(registry, 8);
+            history.track<Rect, Color, Velocity>();
+
+            const u64 frame = history.save();   // every tick, after { Registry::update }
+            ...
+            history.restore(frame);             // rewind, the next { save } drops the frames after it
+
+        A frame is made of sections: entity slots, masks, groups and the dense ids and components of every
+        tracked type. A section which did not change since the frame the registry was last saved as (or
+        restored to) is not copied, the frame refers to the copy of an older frame instead. Restoring only
+        copies the sections which differ from the current state. Sections of the entity structure are
+        unchanged if { Registry::structure_version } is. The components of a pool are unchanged if no
+        component of the pool changed since (see { Base_Pool::get_last_change_tick }), otherwise they are
+        compared with { memcmp }, which only reads. Copies go into buffers owned by the ring slots, they are
+        reused once the ring wraps around, so saving does not allocate once every section reached its
+        largest size.
+
+        So the cost is not proportional to the changed bytes, but to the sections they are in: a pool with
+        a single changed component is compared and copied as a whole. After a structural change the entity
+        sections are compared and copied in full, and restoring walks every entity id. With archetypes
+        there are no per pool ticks: every component section is gathered from (and copied back into) the
+        rows one entity at a time and compared in full, and a structural change rewrites every component
+        section, since rows of entities which moved are left unconstructed.
+
+        Only trivially copyable components can be tracked, and every component type in use must be
+        tracked (checked by { save } when logs are enabled). Systems are not part of the state, restored entities are removed
+        from and added to systems like any other structural change. The system order of entities (and
+        with it the order of their commands) is not restored.
+    */
+    class Frame_History final {
+    private:
+        /*
+            Bytes of a section as they are in the registry.
+        */
+        struct Section_View {
+            const u8* data;
+            u64       size;
+        };
+
+        /*
+            Everything a tracked component type needs without knowing its type.
+        */
+        struct Tracked_Component {
+            const Component_Info* info;
+
+            // Point { ids } and { components } at the current dense arrays, archetypes gather into scratch:
+            void (*read)(Registry& registry, Tracked_Component& tracked, Section_View& ids, Section_View& components);
+
+            /*
+                Replace the components of the type, every entity in { ids } must already have a row (archetypes).
+                Unless { ids_changed } the pool already holds the same entities in the same order.
+            */
+            void (*write)(Registry& registry, const int* ids, const u8* components, int count, bool ids_changed);
+
+            std::vector<u8> scratch_ids;
+            std::vector<u8> scratch_components;
+        };
+
+        /*
+            { sources } has the ring slot which holds the copy of every section, the frame's own slot if
+            the section changed in this frame.
+        */
+        struct Frame {
+            u64              number;
+            u64              structure_version;
+            int              free_entity_id;
+            std::vector<int> sources;
+        };
+
+        static constexpr int SECTION_ENTITIES    = 0;
+        static constexpr int SECTION_MASKS       = 1;
+        static constexpr int SECTION_GROUPS      = 2;
+        static constexpr int FIXED_SECTION_COUNT = 3;
+
+        Registry&                      registry;
+        int                            depth;
+        std::vector<Tracked_Component> tracked_components;
+        Component_Mask                 tracked_mask;
+
+        // Indexed by [section][ring slot]:
+        std::vector<std::vector<std::vector<u8>>> buffers;
+        std::vector<Frame>                        frames;
+        std::vector<Section_View>                 current;
+
+        // Frames { first_frame..first_frame + frame_count } are kept, the registry is at { current_frame }:
+        u64 first_frame   = 0;
+        u64 frame_count   = 0;
+        u64 current_frame = 0;
+
+        // Change tick of the registry when it was last saved as or restored to { current_frame }:
+        u32 current_tick = 0;
+
+    public:
+        Frame_History(Registry& registry, int depth);
+        ~Frame_History() = default;
+
+        Frame_History(const Frame_History&)            = delete;
+        Frame_History& operator=(const Frame_History&) = delete;
+
+        /*
+            Add component types to every frame saved from now on, must be called before the first { save }.
+        */
+        template <typename ...T_Components>
+        void
+        track();
+
+        /*
+            Save the current state as a new frame after the current one and return its number. Frames after
+            the current one (left by a { restore }) are dropped, the oldest frame is dropped when the ring is
+            full.
+        */
+        u64
+        save();
+
+        /*
+            Bring the registry back to the given frame, returns { false } if it's not in the history anymore.
+            Kills and commands pending since the last { Registry::update } are dropped, systems are brought up
+            to date with the restored entities. Events and the change tick are not touched.
+        */
+        bool
+        restore(u64 frame);
+
+        bool
+        has_frame(u64 frame) const;
+
+        u64
+        get_oldest_frame() const;
+
+        u64
+        get_newest_frame() const;
+
+        int
+        get_depth() const;
+
+    private:
+        int
+        get_section_count() const;
+
+        int
+        get_slot(u64 frame) const;
+
+        /*
+            Point { current } at every section of the registry.
+        */
+        void
+        read_registry();
+
+        /*
+            Before the slot of the oldest frame is reused, hand its copies over to the next frame.
+        */
+        void
+        drop_oldest_frame();
+
+        bool
+        matches(int section, int slot) const;
+
+        /*
+            Sections which only change with { Registry::structure_version }: entity slots, masks, groups and
+            the entity ids of every tracked type. They are not compared when the versions are equal.
+        */
+        bool
+        is_structure_section(int section) const;
+
+        /*
+            Whether a component section is still as it was at { current_frame }: the structure is the same and
+            no component of the pool changed since. Always { false } with archetypes, which are compared.
+        */
+        bool
+        is_untouched(int section) const;
+
+        /*
+            Bring entity slots, masks and systems to the given frame, in archetype mode entities whose mask
+            changed are moved into rows of their restored archetype.
+        */
+        void
+        restore_entities(const Frame& frame);
+
+        template <typename T>
+        static void
+        read_component(Registry& registry, Tracked_Component& tracked, Section_View& ids, Section_View& components);
+
+        template <typename T>
+        static void
+        write_component(Registry& registry, const int* ids, const u8* components, int count, bool ids_changed);
+    };
+
+    /*
+    ## Frame_History: template implementations
+    */
+
+    template <typename ...T_Components>
+    void
+    Frame_History::track() {
+        static_assert(
+            (std::is_trivially_copyable_v<T_Components> && ...),
+            "Only trivially copyable components can be tracked by a { Frame_History }!"
+        );
+
+        ERROR_IF(frame_count > 0, "Component types must be tracked before the first frame is saved!");
+
+        auto track_component = [&](const Component_Info& info, auto read, auto write) {
+            if (tracked_mask.test(info.type_id)) {
+                return;
+            }
+
+            tracked_mask.set(info.type_id);
+            tracked_components.push_back({ &info, read, write, {}, {} });
+
+        #if PROJECT_ECS_STORAGE_ARCHETYPES
+            registry.component_storage.register_component(info);
+        #endif
+        };
+
+        (track_component(
+            Component<T_Components>::get_info(), &read_component<T_Components>, &write_component<T_Components>
+        ), ...);
+
+        // Two sections per component, ids and components:
+        buffers.resize(get_section_count(), std::vector<std::vector<u8>>(depth));
+        current.resize(get_section_count());
+    }
+
+    template <typename T>
+    void
+    Frame_History::read_component(Registry& registry, Tracked_Component& tracked, Section_View& ids, Section_View& components) {
+    #if PROJECT_ECS_STORAGE_ARCHETYPES
+        // Rows are spread over archetypes and chunks, gather them in archetype order:
+        Archetype_Storage& storage = registry.component_storage;
+        tracked.scratch_ids.clear();
+        tracked.scratch_components.clear();
+
+        for (int index = 0; index < storage.get_archetype_count(); index++) {
+            Archetype& archetype = storage.get_archetype(index);
+            const int column     = archetype.get_column(Component<T>::get_type_id());
+            if (column == Archetype::NO_COLUMN) {
+                continue;
+            }
+
+            for (int chunk = 0; chunk < archetype.get_chunk_count(); chunk++) {
+                const u8* chunk_ids        = reinterpret_cast<const u8*>(archetype.get_entity_ids(chunk));
+                const u8* chunk_components = archetype.get_column_data(chunk, column);
+                const int chunk_count      = archetype.get_chunk(chunk).count;
+
+                tracked.scratch_ids.insert(tracked.scratch_ids.end(), chunk_ids, chunk_ids + sizeof(int) * chunk_count);
+                tracked.scratch_components.insert(
+                    tracked.scratch_components.end(), chunk_components, chunk_components + sizeof(T) * chunk_count
+                );
+            }
+        }
+
+        ids        = { tracked.scratch_ids.data(), tracked.scratch_ids.size() };
+        components = { tracked.scratch_components.data(), tracked.scratch_components.size() };
+    #else
+        const Pool<T>* pool = registry.find_pool<T>();
+        const int count     = pool != nullptr ? pool->get_count() : 0;
+
+        ids        = { count > 0 ? reinterpret_cast<const u8*>(pool->get_entity_ids()) : nullptr, sizeof(int) * count };
+        components = { count > 0 ? reinterpret_cast<const u8*>(pool->get_data()) : nullptr, sizeof(T) * count };
+    #endif
+    }
+
+    template <typename T>
+    void
+    Frame_History::write_component(Registry& registry, const int* ids, const u8* components, int count, bool ids_changed) {
+    #if PROJECT_ECS_STORAGE_ARCHETYPES
+        Archetype_Storage& storage = registry.component_storage;
+        for (int index = 0; index < count; index++) {
+            std::memcpy(&storage.get<T>(ids[index]), components + sizeof(T) * index, sizeof(T));
+        }
+    #else
+        // Only the values changed, the sparse pages are still valid:
+        Pool<T>& pool = registry.get_pool<T>();
+        if (!ids_changed) {
+            pool.assign_values(reinterpret_cast<const T*>(components), count);
+            return;
+        }
+
+        pool.assign(ids, reinterpret_cast<const T*>(components), count);
+    #endif
+    }
+
+} // jbx
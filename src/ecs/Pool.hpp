@@ -1,32 +1,181 @@
 
 #pragma once
 
+#include <ecs/Sparse_Set.hpp>
+#include <ecs/Component.hpp>
+
+// Dependencies (3rd party):
+#include <atomic>
+
 namespace jbx {
 
     /*
         Just an interface which enables us to use the Pool with different types of components
         later.
+
+        Entity bookkeeping does not depend on the component type, so it lives here and can be used
+        without knowing { T }, e.g. to drive a { View } from the smallest pool.
+
+        { change_ticks } is parallel to the components: the tick at which each one was added or last
+        accessed mutably, read from { current_tick } (see { Registry::get_change_tick }). { last_change_tick }
+        is the latest of them, also set when components are removed or moved. Systems access components of
+        different entities mutably from several threads at once, so it is atomic, they all store the same tick.
     */
     class Base_Pool {
+    private:
+        static inline const u32 NO_TICK = 0;
+
+    protected:
+        Sparse_Set            entities;
+        std::vector<u32>      change_ticks;
+        const Component_Info* info;
+        const u32*            current_tick     = &NO_TICK;
+        std::atomic<u32>      last_change_tick = NO_TICK;
+
     public:
+        explicit Base_Pool(const Component_Info& info)
+        : info(&info) {}
+
         virtual ~Base_Pool() {}
 
+        /*
+            Description of the component type stored in the pool.
+        */
+        const Component_Info&
+        get_info() const {
+            return *info;
+        }
+
         virtual void
         remove_entity_from_pool(int entity_id) = 0;
+
+        /*
+            Exchange the components at the two dense indices, with their entities and change ticks. Used to
+            reorder the pool, see { Registry::set_pool_order }, the components are not marked as changed.
+        */
+        virtual void
+        swap_indices(int index_a, int index_b) = 0;
+
+        /*
+            Reserve room for { capacity } components, e.g. before spawning a known number of entities.
+        */
+        virtual void
+        reserve(int capacity) = 0;
+
+        /*
+            Memory held by the components, their change ticks and the dense entity ids, in bytes. The sparse
+            pages are reported separately, see { get_sparse_bytes }.
+        */
+        virtual u64
+        get_memory_bytes() const = 0;
+
+        u64
+        get_sparse_bytes() const {
+            return entities.get_sparse_bytes();
+        }
+
+        int
+        get_page_count() const {
+            return entities.get_page_count();
+        }
+
+        void
+        release_empty_pages() {
+            entities.release_empty_pages();
+        }
+
+        bool
+        contains(int entity_id) const {
+            return entities.contains(entity_id);
+        }
+
+        /*
+            Number of components in the pool, valid dense indices are { 0..get_count() }.
+        */
+        int
+        get_count() const {
+            return entities.get_count();
+        }
+
+        /*
+            Dense index of the component of the entity, or { Sparse_Set::INVALID_INDEX }.
+        */
+        int
+        index_of(int entity_id) const {
+            return entities.index_of(entity_id);
+        }
+
+        /*
+            Entity id which owns the component at the given dense index.
+        */
+        int
+        get_entity_id(int index) const {
+            return entities.entity_at(index);
+        }
+
+        /*
+            Entity id of every component, in dense order.
+        */
+        const int*
+        get_entity_ids() const {
+            return entities.get_dense().data();
+        }
+
+        /*
+            Change tick of every component, in dense order.
+        */
+        const u32*
+        get_change_ticks() const {
+            return change_ticks.data();
+        }
+
+        /*
+            Set the component at the given dense index to the current tick, for writes which do not go
+            through { get }.
+        */
+        void
+        mark_changed(int index) {
+            change_ticks[index] = *current_tick;
+            last_change_tick.store(*current_tick, std::memory_order_relaxed);
+        }
+
+        /*
+            Tick at which any component of the pool was last added, removed, moved or accessed mutably. The
+            pool did not change since { tick } if this is lower.
+        */
+        u32
+        get_last_change_tick() const {
+            return last_change_tick.load(std::memory_order_relaxed);
+        }
+
+        /*
+            Set by the { Registry } when the pool is created, the tick must outlive the pool.
+        */
+        void
+        set_tick_source(const u32* tick) {
+            current_tick = tick;
+        }
     };
 
     /*
-        { Pool } is just an abstraction over vector that we use in the { Registry } to store the
-        data. @todo: Simplify, reduce access time.
+        { Pool } stores the components of one type densely, the { Sparse_Set } in { Base_Pool } maps
+        entity ids to indices into { data }, so { data[i] } belongs to the entity { get_entity_id(i) }.
+
+        Lookups are O(1) without hashing, removal swaps the last component into the removed slot and
+        iteration over { 0..get_count() } is contiguous.
+
+        Components are constructed in place with { emplace } and moved (never copied) when the pool grows or
+        when a component is removed, so move-only components are supported. Unused capacity is reserved,
+        not constructed, and given back once less than a quarter of it is used (see
+        { Sparse_Set::is_oversized }), so a spike of entities does not pin its memory for the whole run.
+
+        Mutable access ({ emplace }, non-const { get } and { operator [] }) marks the component as changed,
+        read only code should go through a const reference to the pool.
     */
     template <typename T>
     class Pool final: public Base_Pool {
     private:
         std::vector<T> data;
-        int            size;
-
-        std::unordered_map<int, int> entity_id_to_index;
-        std::unordered_map<int, int> index_to_entity_id;
 
     public:
         Pool(int capacity = 128);
@@ -34,8 +183,12 @@ namespace jbx {
         virtual
         ~Pool() = default;
 
-        void
-        add(T object);
+        /*
+            Construct the component of the entity from { args }, or replace the existing one.
+        */
+        template <typename ...T_Args>
+        T&
+        emplace(int entity_id, T_Args&& ...args);
 
         void
         set(int entity_id, T object);
@@ -46,95 +199,210 @@ namespace jbx {
         void
         remove_entity_from_pool(int entity_id) override;
 
+        void
+        swap_indices(int index_a, int index_b) override;
+
+        void
+        reserve(int capacity) override;
+
+        u64
+        get_memory_bytes() const override;
+
         T&
         get(int entity_id);
 
+        const T&
+        get(int entity_id) const;
+
         T&
         operator [](int index);
+
+        /*
+            Components in dense order, { get_entity_id(i) } owns { get_data()[i] }.
+        */
+        const T*
+        get_data() const;
+
+        /*
+            Replace the contents of the pool with copies of { components }, owned by { entity_ids } in the
+            same order. Used to load a pool in bulk, it's a single copy for trivially copyable components.
+        */
+        void
+        assign(const int* entity_ids, const T* components, int count);
+
+        /*
+            Replace the value of every component with { components }, which must be in the same order and of
+            the same count as the pool. Every component is marked as changed.
+        */
+        void
+        assign_values(const T* components, int count);
+
+        /*
+            Add a copy of { value } for every one of { entity_ids }, none of which may be in the pool. Used to
+            add components in bulk (see { Registry::instantiate }), the storage grows at most once.
+        */
+        void
+        append(const int* entity_ids, int count, const T& value);
     };
 
 
 
     /*
-    ## Base_Pool: template implementations
+    ## Pool: template implementations
     */
 
     template <typename T>
-    Pool<T>::Pool(int capacity): size(0) {
-        data.resize(capacity);
+    Pool<T>::Pool(int capacity)
+    : Base_Pool(Component<T>::get_info()) {
+        data.reserve(capacity);
+        change_ticks.reserve(capacity);
     }
 
     template <typename T>
-    void
-    Pool<T>::add(T object) {
-        data.push_back(object);
+    template <typename ...T_Args>
+    T&
+    Pool<T>::emplace(int entity_id, T_Args&& ...args) {
+        ERROR_IF(entity_id < 0);
+
+        // If this exists, just replace the object:
+        const int index = entities.index_of(entity_id);
+        if (index != Sparse_Set::INVALID_INDEX) {
+            data[index]         = T(std::forward<T_Args>(args)...);
+            change_ticks[index] = *current_tick;
+            last_change_tick.store(*current_tick, std::memory_order_relaxed);
+            return data[index];
+        }
+
+        // Otherwise create a new entry, dense indices always match the end of { data }:
+        entities.insert(entity_id);
+        change_ticks.push_back(*current_tick);
+        last_change_tick.store(*current_tick, std::memory_order_relaxed);
+        return data.emplace_back(std::forward<T_Args>(args)...);
     }
 
     template <typename T>
     void
     Pool<T>::set(int entity_id, T object) {
-        ERROR_IF(entity_id < 0);
-
-        // If this exists, just replace the object:
-        if (entity_id_to_index.find(entity_id) != entity_id_to_index.end()) {
-            int index = entity_id_to_index[entity_id];
-            data[index] = object;
-        } else {
-            // Otherwise create a new entry:
-            int index = size;
-            entity_id_to_index.emplace(entity_id, index);
-            index_to_entity_id.emplace(index, entity_id);
-
-            // If there's not enough capacity, double it:
-            if (index >= data.capacity()) {
-                data.resize(size * 2);
-            }
-
-            data[index] = object;
-            size += 1;
-        }
+        emplace(entity_id, std::move(object));
     }
 
     template <typename T>
     void
     Pool<T>::remove(int entity_id) {
-        ERROR_IF(size == 0, "The Pool is already empty!");
-
-        // Swap the removed and the last:
-        int index_of_removed   = entity_id_to_index[entity_id];
-        int index_of_last      = size - 1;
-        data[index_of_removed] = data[index_of_last];
-
-        // Update the index-entity mappings:
-        int entity_id_of_last_element                 = index_to_entity_id[index_of_last];
-        entity_id_to_index[entity_id_of_last_element] = index_of_removed;
-        index_to_entity_id[index_of_removed]          = entity_id_of_last_element;
-
-        // Shrink:
-        entity_id_to_index.erase(entity_id);
-        index_to_entity_id.erase(index_of_last);
-        size--;
+        ERROR_IF(entities.get_count() == 0, "The Pool is already empty!");
+
+        // Move the last into the removed slot, then destroy the last:
+        const int index_of_last    = entities.get_count() - 1;
+        const int index_of_removed = entities.swap_remove(entity_id);
+        if (index_of_removed != index_of_last) {
+            data[index_of_removed]         = std::move(data[index_of_last]);
+            change_ticks[index_of_removed] = change_ticks[index_of_last];
+        }
+
+        data.pop_back();
+        change_ticks.pop_back();
+        last_change_tick.store(*current_tick, std::memory_order_relaxed);
+
+        if (entities.is_oversized()) {
+            entities.shrink_to_fit();
+            data.shrink_to_fit();
+            change_ticks.shrink_to_fit();
+        }
     }
 
     template <typename T>
     void
     Pool<T>::remove_entity_from_pool(int entity_id) {
-        if (entity_id_to_index.find(entity_id) != entity_id_to_index.end()) {
+        if (entities.contains(entity_id)) {
             remove(entity_id);
         }
     }
 
+    template <typename T>
+    void
+    Pool<T>::swap_indices(int index_a, int index_b) {
+        entities.swap_indices(index_a, index_b);
+        std::swap(data[index_a], data[index_b]);
+        std::swap(change_ticks[index_a], change_ticks[index_b]);
+        last_change_tick.store(*current_tick, std::memory_order_relaxed);
+    }
+
+    template <typename T>
+    void
+    Pool<T>::reserve(int capacity) {
+        entities.reserve(capacity);
+        data.reserve(capacity);
+        change_ticks.reserve(capacity);
+    }
+
+    template <typename T>
+    u64
+    Pool<T>::get_memory_bytes() const {
+        return data.capacity() * sizeof(T) + change_ticks.capacity() * sizeof(u32) + entities.get_dense_bytes();
+    }
+
     template <typename T>
     T&
     Pool<T>::get(int entity_id) {
-        return static_cast<T&>(data[entity_id_to_index[entity_id]]);
+        const int index = entities.index_of(entity_id);
+        EXPECT(index != Sparse_Set::INVALID_INDEX, "Entity has no component in this pool!");
+
+        change_ticks[index] = *current_tick;
+        last_change_tick.store(*current_tick, std::memory_order_relaxed);
+        return data[index];
+    }
+
+    template <typename T>
+    const T&
+    Pool<T>::get(int entity_id) const {
+        const int index = entities.index_of(entity_id);
+        EXPECT(index != Sparse_Set::INVALID_INDEX, "Entity has no component in this pool!");
+
+        return data[index];
     }
 
     template <typename T>
     T&
     Pool<T>::operator[](int index) {
-        EXPECT(index > 0 && index < data.size);
+        EXPECT(index >= 0 && index < entities.get_count());
+
+        change_ticks[index] = *current_tick;
+        last_change_tick.store(*current_tick, std::memory_order_relaxed);
         return data[index];
     }
 
+    template <typename T>
+    const T*
+    Pool<T>::get_data() const {
+        return data.data();
+    }
+
+    template <typename T>
+    void
+    Pool<T>::assign(const int* entity_ids, const T* components, int count) {
+        entities.assign(entity_ids, count);
+        data.assign(components, components + count);
+        change_ticks.assign(count, *current_tick);
+        last_change_tick.store(*current_tick, std::memory_order_relaxed);
+    }
+
+    template <typename T>
+    void
+    Pool<T>::assign_values(const T* components, int count) {
+        EXPECT(count == entities.get_count(), "Component count does not match the pool!");
+
+        std::copy(components, components + count, data.begin());
+        std::fill(change_ticks.begin(), change_ticks.end(), *current_tick);
+        last_change_tick.store(*current_tick, std::memory_order_relaxed);
+    }
+
+    template <typename T>
+    void
+    Pool<T>::append(const int* entity_ids, int count, const T& value) {
+        entities.append(entity_ids, count);
+        data.insert(data.end(), count, value);
+        change_ticks.insert(change_ticks.end(), count, *current_tick);
+        last_change_tick.store(*current_tick, std::memory_order_relaxed);
+    }
+
 } // jbx
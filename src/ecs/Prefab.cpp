@@ -0,0 +1,45 @@
+// Implements:
+#include <ecs/Prefab.hpp>
+
+namespace jbx {
+
+    /*
+    ## Prefab: implementation
+    */
+
+    const Component_Mask&
+    Prefab::get_mask() const {
+        return mask;
+    }
+
+    int
+    Prefab::get_component_count() const {
+        return static_cast<int>(components.size());
+    }
+
+    int
+    Prefab::get_size() const {
+        return static_cast<int>(bytes.size());
+    }
+
+    int
+    Prefab::push_value(int size, int alignment) {
+        // The bytes are allocated with at least 16 byte alignment, so aligning the offset aligns the value:
+        const int offset = (static_cast<int>(bytes.size()) + alignment - 1) & ~(alignment - 1);
+        bytes.resize(offset + size);
+
+        return offset;
+    }
+
+    const Prefab::Prefab_Component*
+    Prefab::find(int component_type_id) const {
+        for (const Prefab_Component& component: components) {
+            if (component.info->type_id == component_type_id) {
+                return &component;
+            }
+        }
+
+        return nullptr;
+    }
+
+} // jbx
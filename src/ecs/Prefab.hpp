@@ -0,0 +1,110 @@
+
+#pragma once
+
+#include <ecs/Component.hpp>
+
+// Dependencies (3rd party):
+#include <type_traits>
+
+namespace jbx {
+
+    class Registry;
+
+    /*
+        { Prefab } is a set of components with their initial values, which { Registry::instantiate } copies
+        into any number of new entities at once.
+
+        Usage:
+            Prefab particle;
+            particle.add<Rect>(0.0f, 0.0f, 2.0f, 2.0f);
+            particle.add<Velocity>(0.0f, -40.0f);
+
+            registry.instantiate(particle, 10000, spawned);
+
+        The values are packed into one byte template when they are added, so instantiating does not look at
+        the prefab definition again: every component type is resolved once per call, not once per entity.
+        Components are copied byte for byte, which is why they must be trivially copyable.
+    */
+    class Prefab final {
+        friend class Registry;
+
+    private:
+        /*
+            A component of the prefab, its value is stored in { bytes } at { offset }.
+            - { fill }: copies the value into the new component of every entity, resolved when it's added.
+        */
+        struct Prefab_Component {
+            const Component_Info* info;
+            int                   offset;
+            void                (*fill)(Registry& registry, const int* entity_ids, int count, const void* value);
+        };
+
+        Component_Mask                mask;
+        std::vector<Prefab_Component> components;
+        std::vector<u8>               bytes;
+
+    public:
+        Prefab()  = default;
+        ~Prefab() = default;
+
+        /*
+            Construct the value of the component from { args }, or replace it if the prefab already has one.
+        */
+        template <typename T_Component, typename ...T_Component_Args>
+        Prefab&
+        add(T_Component_Args&& ...args);
+
+        template <typename T_Component>
+        bool
+        has() const;
+
+        /*
+            Mutable access to the value of the component, the prefab must have it.
+        */
+        template <typename T_Component>
+        T_Component&
+        get();
+
+        const Component_Mask&
+        get_mask() const;
+
+        int
+        get_component_count() const;
+
+        /*
+            Size of the packed values, in bytes.
+        */
+        int
+        get_size() const;
+
+    private:
+        /*
+            Reserve space for a value of the given size and alignment at the end of { bytes }, returns its offset.
+        */
+        int
+        push_value(int size, int alignment);
+
+        const Prefab_Component*
+        find(int component_type_id) const;
+    };
+
+    /*
+    ## Prefab: template implementations
+    */
+
+    template <typename T_Component>
+    bool
+    Prefab::has() const {
+        return mask.has<T_Component>();
+    }
+
+    template <typename T_Component>
+    T_Component&
+    Prefab::get() {
+        const Prefab_Component* component = find(Component<T_Component>::get_type_id());
+        ERROR_IF(component == nullptr, "Prefab does not have this component!");
+
+        return *reinterpret_cast<T_Component*>(bytes.data() + component->offset);
+    }
+
+} // jbx
@@ -2,43 +2,354 @@
 // Implements:
 #include <ecs/Registry.hpp>
 
+// Dependencies (3rd party):
+#include <algorithm>
+
 namespace jbx {
 
+    Registry::Registry() {
+    #if PROJECT_ECS_STORAGE_ARCHETYPES
+        component_storage.set_tick_source(&change_tick);
+    #else
+        // Component ids are known at compile time, so every pool slot can exist up front:
+        component_pools.resize(MAX_COMPONENT_TYPES, nullptr);
+    #endif
+
+        // Every thread gets its own buffer, so recording never needs a lock:
+        const int thread_count = get_context<Job_System>()->get_thread_count();
+        for (int buffer_index = 0; buffer_index < thread_count; buffer_index++) {
+            command_buffers.push_back(std::make_unique<Command_Buffer>(buffer_index));
+        }
+
+        spawned_entities.resize(thread_count);
+    }
+
     Entity
     Registry::create_entity() {
         int entity_id;
 
         // If no free ids are available:
-        if (available_ids.empty()) {
-            entity_id     = num_entities;
-            num_entities += 1;
-
-            // Resize the collection if necessary:
-            if (entity_id >= component_masks.size()) {
-                component_masks.resize(entity_id + 1);
-            }
+        if (free_entity_id == NULL_ENTITY_ID) {
+            entity_id = static_cast<int>(entity_slots.size());
+            entity_slots.emplace_back(entity_id, trimmed_generation);
+            component_masks.emplace_back();
+            entity_groups.push_back(NO_GROUP);
         }
         else {
-            // Otherwise re-use an id:
-            entity_id = available_ids.front();
-            available_ids.pop_front();
+            // Otherwise re-use an id, generation was already incremented when it was released:
+            entity_id                  = free_entity_id;
+            free_entity_id             = entity_slots[entity_id].id;
+            entity_slots[entity_id].id = entity_id;
         }
 
-        Entity entity(entity_id);
-        new_entities.insert(entity);
+        Entity entity = entity_slots[entity_id];
+        new_entities.push_back(entity);
+        change_structure();
 
         return entity;
     }
 
+    void
+    Registry::reserve(int entity_count) {
+        entity_slots.reserve(entity_count);
+        component_masks.reserve(entity_count);
+        entity_groups.reserve(entity_count);
+    }
+
+    void
+    Registry::trim_entities() {
+        const int entity_count = static_cast<int>(entity_slots.size());
+
+        // Living entities are the ones whose slot points to itself:
+        int live_count = entity_count;
+        while (live_count > 0 && entity_slots[live_count - 1].id != live_count - 1) {
+            live_count -= 1;
+        }
+
+        if (entity_count < MIN_TRIM_COUNT || (entity_count - live_count) * 4 < entity_count) {
+            return;
+        }
+
+        for (int entity_id = live_count; entity_id < entity_count; entity_id++) {
+            trimmed_generation = std::max(trimmed_generation, entity_slots[entity_id].generation);
+        }
+
+        entity_slots.erase(entity_slots.begin() + live_count, entity_slots.end());
+        entity_slots.shrink_to_fit();
+        component_masks.resize(live_count);
+        component_masks.shrink_to_fit();
+        entity_groups.resize(live_count);
+        entity_groups.shrink_to_fit();
+
+    #if PROJECT_ECS_STORAGE_ARCHETYPES
+        component_storage.trim_entities(live_count);
+    #endif
+
+        // The free list may point past the cut, link the remaining free slots again, lowest id first:
+        free_entity_id = NULL_ENTITY_ID;
+        for (int entity_id = live_count - 1; entity_id >= 0; entity_id--) {
+            if (entity_slots[entity_id].id != entity_id) {
+                entity_slots[entity_id].id = free_entity_id;
+                free_entity_id             = entity_id;
+            }
+        }
+
+        change_structure();
+    }
+
+    void
+    Registry::release_empty_pages() {
+    #if !PROJECT_ECS_STORAGE_ARCHETYPES
+        for (Shared<Base_Pool>& pool: component_pools) {
+            if (pool != nullptr) {
+                pool->release_empty_pages();
+            }
+        }
+    #endif
+
+        for (auto& system: systems) {
+            system.second->release_empty_pages();
+        }
+
+        for (Sparse_Set& members: group_members) {
+            members.release_empty_pages();
+        }
+    }
+
+    void
+    Registry::get_memory_report(std::vector<Memory_Usage>& report) const {
+        const u64 entity_bytes = entity_slots.capacity() * sizeof(Entity) +
+                                 component_masks.capacity() * sizeof(Component_Mask) +
+                                 entity_groups.capacity() * sizeof(int);
+        report.push_back({ "Entities", entity_bytes, 0 });
+
+    #if PROJECT_ECS_STORAGE_ARCHETYPES
+        report.push_back({ "Archetype chunks", component_storage.get_chunk_bytes(), 0 });
+        report.push_back({ "Archetype entities", component_storage.get_entity_bytes(), 0 });
+    #else
+        for (const Shared<Base_Pool>& pool: component_pools) {
+            if (pool == nullptr) {
+                continue;
+            }
+
+            const std::string name = pool->get_info().name;
+            report.push_back({ name, pool->get_memory_bytes(), 0 });
+            report.push_back({ name + " (sparse)", pool->get_sparse_bytes(), pool->get_page_count() });
+        }
+    #endif
+
+        u64 system_bytes = 0;
+        for (const auto& system: systems) {
+            system_bytes += system.second->get_memory_bytes();
+        }
+        report.push_back({ "Systems", system_bytes, 0 });
+
+        u64 group_bytes = 0;
+        int group_pages = 0;
+        for (const Sparse_Set& members: group_members) {
+            group_bytes += members.get_dense_bytes() + members.get_sparse_bytes();
+            group_pages += members.get_page_count();
+        }
+        report.push_back({ "Groups", group_bytes, group_pages });
+    }
+
+    void
+    Registry::instantiate(const Prefab& prefab, int count, std::vector<Entity>& entities) {
+        if (count <= 0) {
+            return;
+        }
+
+        // Create the entities first, with the complete mask, so systems match them once in { update }:
+        entities.reserve(entities.size() + count);
+        new_entities.reserve(new_entities.size() + count);
+        instantiated_ids.clear();
+
+        for (int index = 0; index < count; index++) {
+            const Entity entity = create_entity();
+            component_masks[entity.id] = prefab.mask;
+
+            entities.push_back(entity);
+            instantiated_ids.push_back(entity.id);
+        }
+
+        if (prefab.components.empty()) {
+            return;
+        }
+
+    #if PROJECT_ECS_STORAGE_ARCHETYPES
+        // Place the entities into the archetype of the prefab, their components are filled in below:
+        for (const Prefab::Prefab_Component& component: prefab.components) {
+            component_storage.register_component(*component.info);
+        }
+
+        for (int entity_id: instantiated_ids) {
+            component_storage.insert_entity(entity_id, prefab.mask);
+        }
+    #endif
+
+        // Then copy every value of the prefab into the storage of its type, in one pass per type:
+        for (const Prefab::Prefab_Component& component: prefab.components) {
+            component.fill(*this, instantiated_ids.data(), count, prefab.bytes.data() + component.offset);
+        }
+    }
+
     void
     Registry::kill_entity(Entity entity) {
-        dead_entities.insert(entity);
+        ERROR_IF(!is_alive(entity), "Stale entity handle given to { kill_entity }!");
+        dead_entities.push_back(entity);
+    }
+
+    Command_Buffer&
+    Registry::get_commands() {
+        const int thread_index = get_context<Job_System>()->get_thread_index();
+        ERROR_IF(thread_index < 0, "{ get_commands } called from a thread which is not part of the { Job_System }!");
+
+        return *command_buffers[thread_index];
+    }
+
+    Event_Bus&
+    Registry::get_events() {
+        return event_bus;
+    }
+
+    Entity
+    Registry::resolve_entity(Entity entity) const {
+        if (!Command_Buffer::is_placeholder(entity)) {
+            return entity;
+        }
+
+        // Placeholders are only valid until the commands are played back:
+        const std::vector<Entity>& spawned = spawned_entities[entity.generation];
+        const int spawn_index              = Command_Buffer::get_placeholder_index(entity);
+        if (spawn_index >= static_cast<int>(spawned.size())) {
+            return Entity(NULL_ENTITY_ID);
+        }
+
+        return spawned[spawn_index];
+    }
+
+    void
+    Registry::play_back_commands() {
+        command_playback.clear();
+
+        for (Unique<Command_Buffer>& buffer: command_buffers) {
+            spawned_entities[buffer->get_buffer_index()].assign(buffer->get_spawn_count(), Entity(NULL_ENTITY_ID));
+            buffer->for_each([&](const Command& command) { command_playback.push_back(&command); });
+        }
+
+        /*
+            Buffers were visited in order, so a stable sort by the order key gives the same sequence no matter
+            which thread recorded which command.
+        */
+        std::stable_sort(command_playback.begin(), command_playback.end(), [](const Command* a, const Command* b) {
+            return a->order < b->order;
+        });
+
+        for (const Command* command: command_playback) {
+            if (command->type == Command_Type_Spawn) {
+                const int buffer_index = static_cast<int>(command->entity.generation);
+                const int spawn_index  = Command_Buffer::get_placeholder_index(command->entity);
+
+                spawned_entities[buffer_index][spawn_index] = create_entity();
+                continue;
+            }
+
+            // Several systems may have decided to kill the same entity, ignore the rest:
+            const Entity entity = resolve_entity(command->entity);
+            if (!is_alive(entity)) {
+                continue;
+            }
+
+            switch (command->type) {
+                case Command_Type_Kill:
+                    kill_entity(entity);
+                    break;
+
+                case Command_Type_Add_Component:
+                case Command_Type_Remove_Component:
+                    command->apply(*this, entity, command->get_payload());
+                    break;
+
+                default:
+                    break;
+            }
+        }
+
+        for (Unique<Command_Buffer>& buffer: command_buffers) {
+            buffer->reset();
+        }
     }
 
     void
     Registry::update() {
+        change_tick += 1;
+
+        // Events sent since the last update become readable, the ones read until now are gone:
+        event_bus.swap();
+
+        // Apply structural changes recorded since the last update, before systems are updated:
+        play_back_commands();
+
+        // Systems pick up the entities created and changed since the last update:
+        sync_systems();
+
+        // Remove entities:
+        for (const Entity& dead_entity: dead_entities) {
+            // The same entity may have been killed more than once:
+            if (!is_alive(dead_entity)) {
+                continue;
+            }
+
+            const int entity_id               = dead_entity.id;
+            const Component_Mask& entity_mask = component_masks[entity_id];
+
+            // Remove an entity from systems:
+            for (auto& system: systems) {
+                if (entity_mask.contains(system.second->get_component_mask())) {
+                    system.second->remove_entity(dead_entity);
+                }
+            }
+
+            // Remove the entity from the component pools it has components in:
+        #if PROJECT_ECS_STORAGE_ARCHETYPES
+            component_storage.remove_entity(entity_id);
+        #else
+            entity_mask.for_each([&](int component_type_id) {
+                component_pools[component_type_id]->remove_entity_from_pool(entity_id);
+            });
+        #endif
+
+            // Reset the mask for this entity:
+            component_masks[entity_id].reset();
+
+            // Make the id available again, every handle to the old entity is now stale:
+            entity_slots[entity_id].generation += 1;
+            entity_slots[entity_id].id          = free_entity_id;
+            free_entity_id                      = entity_id;
+
+            // Cleanup any groups:
+            ungroup_entity(dead_entity);
+            change_structure();
+        }
+
+        dead_entities.clear();
+
+        // Now and then give back the ids of a spike of killed entities:
+        trim_wait -= 1;
+        if (trim_wait <= 0) {
+            trim_wait = TRIM_INTERVAL;
+            trim_entities();
+            release_empty_pages();
+        }
+
+        // Structural changes are done, the pools are stable until the systems run:
+        order_pools();
+    }
+
+    void
+    Registry::sync_systems() {
         // Add entitites:
-        for (auto& new_entity: new_entities) {
+        for (const Entity& new_entity: new_entities) {
             // Get the entity component mask:
             const Component_Mask& entity_mask = component_masks[new_entity.id];
 
@@ -52,76 +363,395 @@ namespace jbx {
 
         new_entities.clear();
 
-        // Remove entities:
-        for (auto dead_entity: dead_entities) {
-            // Remove an entity from systems:
-            for (auto system: systems) {
-                system.second->remove_entity(dead_entity);
+        /*
+            Re-evaluate entities whose mask changed, systems which do not require any of the changed
+            components keep their membership. Adding/removing is idempotent so multiple changes to the same
+            entity in one frame are fine.
+        */
+        for (const Mask_Change& change: mask_changes) {
+            const Component_Mask& entity_mask = component_masks[change.entity.id];
+            const Component_Mask changed_bits = entity_mask ^ change.previous_mask;
+
+            for (auto& system: systems) {
+                const Component_Mask& system_mask = system.second->get_component_mask();
+                if (!system_mask.intersects(changed_bits)) {
+                    continue;
+                }
+
+                if (entity_mask.contains(system_mask)) {
+                    system.second->add_entity(change.entity);
+                } else {
+                    system.second->remove_entity(change.entity);
+                }
+            }
+        }
+
+        mask_changes.clear();
+    }
+
+    void
+    Registry::set_pool_order(Pool_Order_Fn key_fn, int steps_per_update) {
+        pool_order                  = Pool_Order_State();
+        pool_order.key_fn           = key_fn;
+        pool_order.steps_per_update = steps_per_update;
+    }
+
+    void
+    Registry::order_pools() {
+    #if !PROJECT_ECS_STORAGE_ARCHETYPES
+        Pool_Order_State& state = pool_order;
+        if (state.key_fn == nullptr || state.steps_per_update <= 0) {
+            return;
+        }
+
+        if (state.step == Pool_Order_Step_Keys && state.position == 0) {
+            if (state.wait > 0) {
+                state.wait -= 1;
+                return;
             }
-            int entity_id = dead_entity.id;
 
-            // Remove the entity from the component pools:
-            for (auto pool: component_pools) {
-                if (pool != nullptr) {
-                    pool->remove_entity_from_pool(entity_id);
+            /*
+                A pass starts with fresh keys, for the systems which exist now. The arrays of the pass only grow
+                as they are filled, so their memory is touched a chunk at a time.
+            */
+            state.keys.clear();
+            state.keys.reserve(entity_slots.size());
+            state.systems.clear();
+            for (auto& system: systems) {
+                state.systems.push_back(system.second.get());
+            }
+        }
+
+        // Entities created since the keys were computed have none, they go last:
+        const std::vector<u64>& keys = state.keys;
+        auto get_key                 = [&](int entity_id) {
+            return entity_id < static_cast<int>(keys.size()) ? keys[entity_id] : ~u64(0);
+        };
+        auto by_key = [&](int a, int b) {
+            const u64 key_a = get_key(a);
+            const u64 key_b = get_key(b);
+            return key_a < key_b || (key_a == key_b && a < b);
+        };
+
+        /*
+            Targets are the pools, then the systems. Both keep their entities densely and can swap them, the
+            pools move their components along.
+        */
+        const int target_count = MAX_COMPONENT_TYPES + static_cast<int>(state.systems.size());
+        auto get_pool          = [&](int target) -> Base_Pool* {
+            return target < MAX_COMPONENT_TYPES ? component_pools[target].get() : nullptr;
+        };
+        auto get_system = [&](int target) -> Base_System* {
+            return target >= MAX_COMPONENT_TYPES ? state.systems[target - MAX_COMPONENT_TYPES] : nullptr;
+        };
+        auto get_count = [&](int target) {
+            const Base_Pool* pool     = get_pool(target);
+            const Base_System* system = get_system(target);
+            return pool != nullptr ? pool->get_count() : system != nullptr ? static_cast<int>(system->get_entities().size()) : 0;
+        };
+
+        // Start over with the next target, or with the same one if it changed under us:
+        auto next_target = [&](int target) {
+            state.target   = target;
+            state.step     = Pool_Order_Step_Collect;
+            state.position = 0;
+            state.sorted   = true;
+        };
+
+        const u64 swap_count = state.swap_count;
+        bool pools_swapped   = false;
+
+        int steps = state.steps_per_update;
+        while (steps > 0) {
+            if (state.step == Pool_Order_Step_Keys) {
+                const int key_count = static_cast<int>(entity_slots.size());
+                const int count     = std::min(steps, key_count - state.position);
+                if (count > 0) {
+                    state.keys.resize(state.position + count);
+                    for (int index = 0; index < count; index++) {
+                        state.keys[state.position + index] = static_cast<u64>(state.position + index);
+                    }
+
+                    state.key_fn(*this, state.position, count, state.keys.data() + state.position);
+                    state.position += count;
+                    steps          -= count;
+                }
+
+                if (state.position >= key_count) {
+                    next_target(0);
                 }
+                continue;
             }
 
-            // Reset the mask for this entity:
-            component_masks[entity_id].reset();
+            if (state.target == target_count) {
+                break;
+            }
 
-            // Make the id available again:
-            available_ids.push_back(entity_id);
+            const int count = get_count(state.target);
+            if (count < 2) {
+                next_target(state.target + 1);
+                continue;
+            }
 
-            // Cleanup any groups:
-            ungroup_entity(dead_entity);
+            // Components were added or removed since the ids were collected, collect them again:
+            if (state.step != Pool_Order_Step_Collect && static_cast<int>(state.ids.size()) != count) {
+                next_target(state.target);
+                continue;
+            }
+
+            switch (state.step) {
+                case Pool_Order_Step_Collect: {
+                    if (state.position == 0) {
+                        state.ids.clear();
+                        state.ids.reserve(count);
+                    }
+
+                    // Ids collected before a change are stale, placing them finds out and starts over:
+                    if (state.position > count) {
+                        next_target(state.target);
+                        break;
+                    }
+
+                    const Base_Pool* pool     = get_pool(state.target);
+                    const Base_System* system = get_system(state.target);
+                    const int end             = std::min(count, state.position + steps);
+                    for (int index = state.position; index < end; index++) {
+                        state.ids.push_back(pool != nullptr ? pool->get_entity_id(index) : system->get_entities()[index].id);
+                        state.sorted = state.sorted && (index == 0 || !by_key(state.ids[index], state.ids[index - 1]));
+                    }
+
+                    steps          -= end - state.position;
+                    state.position  = end;
+
+                    if (state.position == count) {
+                        state.position = 0;
+                        if (state.sorted) {
+                            next_target(state.target + 1);
+                        } else {
+                            state.step = Pool_Order_Step_Runs;
+                        }
+                    }
+                    break;
+                }
+
+                case Pool_Order_Step_Runs: {
+                    if (state.position == 0) {
+                        state.merged.clear();
+                        state.merged.reserve(count);
+                    }
+
+                    const int end = std::min(count, state.position + POOL_ORDER_RUN);
+                    std::sort(state.ids.begin() + state.position, state.ids.begin() + end, by_key);
+                    state.merged.resize(end);
+
+                    steps          -= end - state.position;
+                    state.position  = end;
+
+                    if (state.position == count) {
+                        state.step        = Pool_Order_Step_Merge;
+                        state.width       = POOL_ORDER_RUN;
+                        state.merge_start = 0;
+                        state.left        = 0;
+                        state.right       = std::min(count, POOL_ORDER_RUN);
+                        state.position    = 0;
+                    }
+                    break;
+                }
+
+                case Pool_Order_Step_Merge: {
+                    // Runs of { width } were sorted, merge pairs of them into runs of twice the width:
+                    if (state.width >= count) {
+                        state.step     = Pool_Order_Step_Place;
+                        state.position = 0;
+                        break;
+                    }
+
+                    const int middle = std::min(count, state.merge_start + state.width);
+                    const int end    = std::min(count, state.merge_start + 2 * state.width);
+
+                    for (; state.position < end && steps > 0; state.position++, steps--) {
+                        const bool take_right = state.left == middle ||
+                                                (state.right < end && by_key(state.ids[state.right], state.ids[state.left]));
+
+                        state.merged[state.position] = take_right ? state.ids[state.right++] : state.ids[state.left++];
+                    }
+
+                    if (state.position < end) {
+                        break;
+                    }
+
+                    // On to the next pair, or to the next width once every pair was merged:
+                    state.merge_start = end;
+                    if (state.merge_start == count) {
+                        std::swap(state.ids, state.merged);
+                        state.width      *= 2;
+                        state.merge_start = 0;
+                    }
+
+                    state.left     = state.merge_start;
+                    state.right    = std::min(count, state.merge_start + state.width);
+                    state.position = state.merge_start;
+                    break;
+                }
+
+                case Pool_Order_Step_Place: {
+                    // Place the entities one by one, every swap puts one of them where it belongs:
+                    Base_Pool* pool     = get_pool(state.target);
+                    Base_System* system = get_system(state.target);
+
+                    for (; state.position < count && steps > 0; state.position++, steps--) {
+                        const int entity_id = state.ids[state.position];
+                        const int index     = pool != nullptr ? pool->index_of(entity_id) : system->index_of(entity_id);
+
+                        // Left the target, or the ids were collected while it changed:
+                        if (index == Sparse_Set::INVALID_INDEX || index < state.position) {
+                            next_target(state.target);
+                            break;
+                        }
+
+                        if (index == state.position) {
+                            continue;
+                        }
+
+                        if (pool != nullptr) {
+                            pool->swap_indices(state.position, index);
+                            pools_swapped = true;
+                        } else {
+                            system->swap_indices(state.position, index);
+                        }
+
+                        state.swap_count += 1;
+                    }
+
+                    if (state.step == Pool_Order_Step_Place && state.position == count) {
+                        next_target(state.target + 1);
+                    }
+                    break;
+                }
+
+                default:
+                    break;
+            }
         }
 
-        dead_entities.clear();
+        // The dense order of the pools is part of the structure, e.g. { Frame_History } saves it:
+        if (pools_swapped) {
+            change_structure();
+        }
+
+        if (state.step == Pool_Order_Step_Keys || state.target < target_count) {
+            return;
+        }
+
+        // The pass is done, the next one starts with fresh keys:
+        state.step        = Pool_Order_Step_Keys;
+        state.target      = 0;
+        state.position    = 0;
+        state.wait        = POOL_ORDER_INTERVAL;
+        state.pass_count += 1;
+    #endif
+    }
+
+    f64
+    Registry::get_pool_locality() const {
+    #if PROJECT_ECS_STORAGE_ARCHETYPES
+        return 1.0;
+    #else
+        u64 step_count    = 0;
+        u64 forward_count = 0;
+
+        for (const auto& system: systems) {
+            const std::vector<Entity>& entities = system.second->get_entities();
+
+            system.second->get_component_mask().for_each([&](int component_type_id) {
+                const Base_Pool* pool = component_pools[component_type_id].get();
+                if (pool == nullptr) {
+                    return;
+                }
+
+                for (int index = 1; index < static_cast<int>(entities.size()); index++) {
+                    step_count    += 1;
+                    forward_count    += pool->index_of(entities[index].id) > pool->index_of(entities[index - 1].id);
+                }
+            });
+        }
+
+        return step_count > 0 ? static_cast<f64>(forward_count) / static_cast<f64>(step_count) : 1.0;
+    #endif
+    }
+
+    u64
+    Registry::get_pool_order_swap_count() const {
+        return pool_order.swap_count;
+    }
+
+    u64
+    Registry::get_pool_order_pass_count() const {
+        return pool_order.pass_count;
     }
 
     void
     Registry::group_entity(Entity entity, const std::string& group) {
-        // Create a new set if one does not exist already:
-        entities_per_group.emplace(group, std::set<Entity>());
+        // Create the group if it does not exist already:
+        auto group_id = group_ids.find(group);
+        if (group_id == group_ids.end()) {
+            group_id = group_ids.emplace(group, static_cast<int>(group_names.size())).first;
+            group_names.push_back(group);
+            group_members.emplace_back();
+        }
 
-        // Maintain both collections:
-        entities_per_group[group].emplace(entity);
-        groups_per_entity.emplace(entity.id, group);
+        // An entity belongs to a single group, maintain both collections:
+        ungroup_entity(entity);
+        entity_groups[entity.id] = group_id->second;
+        group_members[group_id->second].insert(entity.id);
+        change_structure();
     }
 
     bool
     Registry::entity_belongs_to_group(Entity entity, const std::string& group) const {
-        if (entities_per_group.find(group) == entities_per_group.end()) {
+        auto group_id = group_ids.find(group);
+        if (group_id == group_ids.end() || !is_alive(entity)) {
             return false;
         }
 
-        auto group_entities                   = entities_per_group.at(group);
-        return group_entities.find(entity.id) != group_entities.end();
+        return entity_groups[entity.id] == group_id->second;
     }
 
     std::vector<Entity>
     Registry::get_entities_by_group(const std::string& group) const {
-        auto& set_of_entities = entities_per_group.at(group);
-        return std::vector<Entity>(set_of_entities.begin(), set_of_entities.end());
+        auto group_id = group_ids.find(group);
+        if (group_id == group_ids.end()) {
+            return {};
+        }
+
+        std::vector<Entity> entities;
+        for (int entity_id: group_members[group_id->second].get_dense()) {
+            entities.push_back(entity_slots[entity_id]);
+        }
+
+        return entities;
     }
 
     void
     Registry::ungroup_entity(Entity entity) {
-        // Iterator to the grouped entity:
-        auto grouped_entity = groups_per_entity.find(entity.id);
-        if (grouped_entity != groups_per_entity.end()) {
-
-            // Iterator to the group:
-            auto group = entities_per_group.find(grouped_entity->second);
-            if (group != entities_per_group.end()) {
-                auto entity_in_group = group->second.find(entity);
-                if (entity_in_group != group->second.end()) {
-                    group->second.erase(entity_in_group);
-                }
-            }
+        const int group_id = entity_groups[entity.id];
+        if (group_id != NO_GROUP) {
+            group_members[group_id].swap_remove(entity.id);
+            entity_groups[entity.id] = NO_GROUP;
+            change_structure();
+        }
+    }
 
-            groups_per_entity.erase(grouped_entity);
+    void
+    Registry::rebuild_group_members() {
+        for (Sparse_Set& members: group_members) {
+            members.clear();
+        }
+
+        for (int entity_id = 0; entity_id < static_cast<int>(entity_groups.size()); entity_id++) {
+            if (entity_groups[entity_id] != NO_GROUP) {
+                group_members[entity_groups[entity_id]].insert(entity_id);
+            }
         }
     }
 
@@ -130,4 +760,27 @@ namespace jbx {
         return component_masks[entity.id];
     }
 
+    void
+    Registry::run_systems(System_Phase phase, f64 delta_time) {
+        change_tick += 1;
+        scheduler.run(phase, delta_time);
+
+        // Next time, systems only need the changes made from this tick on:
+        for (auto& system: systems) {
+            if (system.second->get_phase() == phase) {
+                system.second->set_last_run_tick(change_tick);
+            }
+        }
+    }
+
+    const std::vector<System_Timing>&
+    Registry::get_system_timings(System_Phase phase) const {
+        return scheduler.get_timings(phase);
+    }
+
+    f64
+    Registry::get_critical_path_ms(System_Phase phase) const {
+        return scheduler.get_critical_path_ms(phase);
+    }
+
 } // jbx
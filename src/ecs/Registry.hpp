@@ -5,43 +5,215 @@
 #include <ecs/Component.hpp>
 #include <ecs/Base_System.hpp>
 #include <ecs/Pool.hpp>
+#include <ecs/View.hpp>
+#include <ecs/System_Scheduler.hpp>
+#include <ecs/Command_Buffer.hpp>
+#include <ecs/Prefab.hpp>
+#include <ecs/Event_Bus.hpp>
 
 namespace jbx {
 
     #define get_type_index(type)        std::type_index(typeid(type))
 
+    /*
+        Storage of a single component type, both { Pool } and { Archetype_Column } support { get(entity_id) }
+        and { contains(entity_id) }, so systems can be written once for either storage mode.
+    */
+#if PROJECT_ECS_STORAGE_ARCHETYPES
+    template <typename T>
+    using Component_Storage = Archetype_Column<T>;
+#else
+    template <typename T>
+    using Component_Storage = Pool<T>;
+#endif
+
+    class Registry;
+
+    /*
+        Fills the order keys of the { count } entity ids from { first_entity_id } on, { keys[i] } belongs to
+        { first_entity_id + i } and comes pre-filled with the id itself. Some of the ids may be free. Called
+        with a few ids at a time, see { Registry::set_pool_order }.
+    */
+    typedef void (*Pool_Order_Fn)(Registry& registry, int first_entity_id, int count, u64* keys);
+
+    /*
+        One line of { Registry::get_memory_report }, { page_count } is 0 for storage which is not paged.
+    */
+    struct Memory_Usage {
+        std::string name;
+        u64         bytes;
+        int         page_count;
+    };
+
     /*
         The ECS Registry keeps it all together, it's just a manager class that handles
         everything ECS related.
 
         { component_pools }: contain all the data for each component type, where:
-        - { vector } is the index of component type.
+        - { vector } is the index of component type, it has a slot for every possible id.
         - { Base_Pool } index is the entity id.
 
+        When built with { PROJECT_ECS_STORAGE=Archetypes } the pools are replaced by { component_storage },
+        see { Archetype_Storage }. Pool specific functions ({ get_pool }) are not available in that mode.
+
         Perhaps we can move the { Component_Mask } into the entity struct itself, since it's
         most commonly used.
 
         @todo: profile to see if it actually matters ...
     */
     class Registry final {
+        // Save and restore the private state directly:
+        friend class Snapshot;
+        friend class Frame_History;
+
+        // Fills the components of instantiated entities, see { fill_components }:
+        friend class Prefab;
+
     private:
-        int num_entities = 0;
+        /*
+            { entity_slots } holds the current handle for every entity id. Slots of killed entities form an
+            intrusive free list: their { id } is the next free slot (or { NULL_ENTITY_ID }), and their
+            { generation } is already incremented for the next entity which will use the slot.
+        */
+        static constexpr int NULL_ENTITY_ID = -1;
+
+        std::vector<Entity> entity_slots;
+        int                 free_entity_id = NULL_ENTITY_ID;
+
+        /*
+            Free ids at the end of { entity_slots } are cut off every { TRIM_INTERVAL } updates, when they are
+            at least a quarter of the ids, see { trim_entities }. Slots created past the cut start with
+            { trimmed_generation }, the highest generation cut off, so handles to cut entities stay stale.
+            Empty sparse pages are released at the same time, see { release_empty_pages }.
+        */
+        static constexpr int TRIM_INTERVAL  = 256;
+        static constexpr int MIN_TRIM_COUNT = Sparse_Set::PAGE_SIZE;
+
+        int trim_wait          = TRIM_INTERVAL;
+        u32 trimmed_generation = 0;
 
+    #if PROJECT_ECS_STORAGE_ARCHETYPES
+        Archetype_Storage              component_storage;
+    #else
         std::vector<Shared<Base_Pool>> component_pools;
+    #endif
         std::vector<Component_Mask>    component_masks;
 
         std::unordered_map<std::type_index, Shared<Base_System>> systems;
+        System_Scheduler                                         scheduler;
+
+        /*
+            Structural changes are applied to systems in { update }:
+            - { new_entities } are matched against every system.
+            - { mask_changes } hold the mask an entity had before a component was added or removed, only
+              systems whose mask overlaps the changed bits are re-evaluated.
+            - { dead_entities } are removed from every system and pool they belong to.
+
+            All of these are linear in the number of changed entities.
+        */
+        struct Mask_Change {
+            Entity         entity;
+            Component_Mask previous_mask;
+        };
+
+        std::vector<Entity>      new_entities;
+        std::vector<Mask_Change> mask_changes;
+        std::vector<Entity>      dead_entities;
+
+        // Ids of the entities created by the current { instantiate }:
+        std::vector<int>         instantiated_ids;
+
+        /*
+            { structure_version } changes whenever entities are created or killed, components are added or
+            removed, groups change or pools are reordered (see { set_pool_order }), i.e. everything but the
+            values of components. Every change takes a new value from { last_structure_version }, so equal
+            versions mean equal structure, see { Frame_History }.
+        */
+        u64 structure_version      = 0;
+        u64 last_structure_version = 0;
 
-        std::set<Entity> new_entities;
-        std::set<Entity> dead_entities;
+        /*
+            Components remember the tick at which they were added or last accessed mutably, see
+            { each_changed }. Ticks start at 1, so 0 is older than every change.
+        */
+        u32 change_tick = 1;
+
+        /*
+            One { Command_Buffer } per { Job_System } thread, played back at the start of { update }.
+            { spawned_entities } maps the placeholders of every buffer to the entities created for them.
+        */
+        std::vector<Unique<Command_Buffer>> command_buffers;
+        std::vector<const Command*>         command_playback;
+        std::vector<std::vector<Entity>>    spawned_entities;
 
-        std::unordered_map<std::string, std::set<Entity>> entities_per_group;
-        std::unordered_map<int, std::string>              groups_per_entity;
+        // Swapped at the start of { update }, events sent during a frame are read in the next:
+        Event_Bus event_bus;
 
-        std::deque<int> available_ids;
+        /*
+            Pools are sorted in passes, a few steps at the end of every { update }, see { set_pool_order }. A
+            pass fills { keys }, then goes through every target (the pools by component type id, then the
+            systems in { systems }) one step at a time:
+            - { Pool_Order_Step_Keys }:    the key of every entity id, { position } is the next id.
+            - { Pool_Order_Step_Collect }: copy the entity ids of the target into { ids }, checking if they
+                                           are already in order, { position } is the next one.
+            - { Pool_Order_Step_Runs }:    sort { ids } in runs of { POOL_ORDER_RUN }, { position } is the
+                                           start of the next run.
+            - { Pool_Order_Step_Merge }:   merge the runs of { width } from { ids } into { merged }, the runs
+                                           from { merge_start }, { left } and { right } are the next ids of
+                                           both runs and { position } the next one written.
+            - { Pool_Order_Step_Place }:   swap the entities of the target into the order of { ids },
+                                           { position } is the next one to place.
+            { wait } counts the updates until the next pass starts.
+        */
+        static constexpr int POOL_ORDER_INTERVAL = 60;
+        static constexpr int POOL_ORDER_RUN      = 32;
+
+        enum Pool_Order_Step : u8 {
+            Pool_Order_Step_Keys = 0,
+            Pool_Order_Step_Collect,
+            Pool_Order_Step_Runs,
+            Pool_Order_Step_Merge,
+            Pool_Order_Step_Place
+        };
+
+        struct Pool_Order_State {
+            Pool_Order_Fn             key_fn           = nullptr;
+            int                       steps_per_update = 0;
+            Pool_Order_Step           step             = Pool_Order_Step_Keys;
+            int                       target           = 0;
+            int                       position         = 0;
+            int                       width            = 0;
+            int                       merge_start      = 0;
+            int                       left             = 0;
+            int                       right            = 0;
+            int                       wait             = 0;
+            bool                      sorted           = true;
+            std::vector<Base_System*> systems;
+            std::vector<int>          ids;
+            std::vector<int>          merged;
+            std::vector<u64>          keys;
+            u64                       swap_count       = 0;
+            u64                       pass_count       = 0;
+        };
+
+        Pool_Order_State pool_order;
+
+        /*
+            Groups are stored flat, so they can be copied like the rest of the entity data:
+            - { entity_groups }: group id of every entity id, or { NO_GROUP }.
+            - { group_members }: entity ids of every group, a group id indexes { group_names } too.
+
+            Group ids are never released, so they stay valid when { entity_groups } is restored.
+        */
+        static constexpr int NO_GROUP = -1;
+
+        std::vector<int>                     entity_groups;
+        std::vector<Sparse_Set>              group_members;
+        std::vector<std::string>             group_names;
+        std::unordered_map<std::string, int> group_ids;
 
     public:
-        Registry()  = default;
+        Registry();
         ~Registry() = default;
 
         void
@@ -50,6 +222,43 @@ namespace jbx {
         Entity
         create_entity();
 
+        /*
+            Create { count } entities with every component of the { prefab }, and append them to { entities }.
+            Entities and components are added in bulk: every component type is resolved once, its storage
+            grows at most once and the values are copied from the prefab, so this is much cheaper than
+            { create_entity } and { add_component } per entity. Systems pick the entities up in { update }.
+        */
+        void
+        instantiate(const Prefab& prefab, int count, std::vector<Entity>& entities);
+
+        /*
+            Check if the handle still refers to a living entity, i.e. it was not killed and its id was not
+            re-used since. This is a single array load.
+        */
+        bool
+        is_alive(Entity entity) const;
+
+        /*
+            Reserve room for { entity_count } entity ids, e.g. before spawning a level, so the per entity
+            arrays do not grow while it's being created. Pools have their own { Base_Pool::reserve }.
+
+            The per entity arrays (slots, masks and groups) are flat, they are copied in bulk by { Snapshot }
+            and { Frame_History }. They are only cut back down to the highest live id (see { trim_entities }),
+            so their memory follows that id rather than the number of live entities: a single entity which
+            outlives a spike keeps the arrays of the whole spike.
+        */
+        void
+        reserve(int entity_count);
+
+        /*
+            Append the memory held by the entities, every pool (with its sparse pages), the systems and the
+            groups to { report }, in bytes of allocated capacity. Meant for reports, costs a pass over the pools.
+            The "Entities" line covers every id up to the highest live one, not only the live entities, see
+            { reserve }.
+        */
+        void
+        get_memory_report(std::vector<Memory_Usage>& report) const;
+
         /*
         ## Group management:
         */
@@ -70,26 +279,215 @@ namespace jbx {
         ## Component management:
         */
 
+        /*
+            Construct the component in place from { args }, or replace the existing one. The reference is
+            valid until the next structural change of this component type.
+        */
         template <typename T_Component, typename ...T_Component_Args>
-        void add_component(Entity entity, T_Component_Args&& ...args);
+        T_Component& add_component(Entity entity, T_Component_Args&& ...args);
 
         template <typename T_Component>
         void remove_component(Entity entity);
 
+        /*
+            Mutable access, marks the component as changed.
+        */
         template <typename T_Component>
         T_Component& get_component(Entity entity);
 
+        /*
+            Mark the component as changed, for writes made through a pointer or reference obtained earlier
+            (e.g. from { View::each_chunk }).
+        */
+        template <typename T_Component>
+        void mark_changed(Entity entity);
+
+        /*
+            Mark the components of { count } entities as changed, e.g. every row of a chunk written through
+            { View::each_chunk }. Every entity must have the component, may be called from several threads
+            for different entities.
+        */
+        template <typename T_Component>
+        void mark_changed(const int* entity_ids, int count);
+
+        /*
+            Call { fn(Entity, const T_Component&) } for every entity whose component was added or accessed
+            mutably at { since_tick } or later. Pass the tick at which the caller last looked: changes made in
+            that same tick are visited again, but none are missed. Costs one tick comparison per component.
+        */
+        template <typename T_Component, typename T_Fn>
+        void each_changed(u32 since_tick, T_Fn&& fn);
+
+        /*
+            The tick changes are currently marked with, advanced by { update } and by every { run_systems }.
+        */
+        u32
+        get_change_tick() const;
+
+        /*
+            Get the storage of the given component type, creating it if it does not exist yet. Systems should
+            resolve their storage once per update, instead of going through { get_component } per entity.
+        */
+        template <typename T_Component>
+        Component_Storage<T_Component>& get_storage();
+
+    #if !PROJECT_ECS_STORAGE_ARCHETYPES
+        /*
+            Same as { get_storage }, for code which depends on the pool layout.
+        */
+        template <typename T_Component>
+        Pool<T_Component>& get_pool();
+    #endif
+
+        /*
+            Create a { View } over every entity which has all of the given components, list the ones which are
+            only read as { const T } so iterating does not mark them as changed.
+        */
+        template <typename ...T_Components>
+        View<T_Components...> view();
+
         template <typename T_System, typename ...T_System_Args>
         void add_system(T_System_Args&& ...args);
 
         template <typename T_System>
         T_System& get_system() const;
 
+        /*
+            Run every system of the given { phase }, systems which do not conflict run in parallel, see
+            { System_Scheduler }. Structural changes (creating entities, adding components ...) must not be
+            made from systems which are not pinned to the main thread.
+        */
+        void
+        run_systems(System_Phase phase, f64 delta_time);
+
+        const std::vector<System_Timing>&
+        get_system_timings(System_Phase phase) const;
+
+        /*
+            Keep the components of every pool sorted by the keys from { key_fn }, e.g. by entity id so the
+            pools of a system line up, or by position so neighbours are close in memory. Removing components
+            swaps the last one into the hole, so without this the order of the pools drifts apart over a long
+            session, and iterating a system hops through memory.
+
+            Sorting is incremental: every { update } does at most { steps_per_update } steps, where a step is
+            the work on a single entity: computing its key, copying its id, moving it while merging, or placing
+            its component (with a swap if needed). So the time spent per update is bounded, no matter how many
+            entities there are. A pass computes fresh keys, sorts every pool, then the entities of every system
+            by the same keys, the next pass starts { POOL_ORDER_INTERVAL } updates after. Pools are sorted with
+            a merge sort, { O(n log n) } steps for a pool of { n } components which is out of order.
+
+            Swapping components does not mark them as changed, it does change { structure_version }. It does
+            not move them in archetype storage, where this does nothing. Pass { nullptr } to stop sorting.
+        */
+        void
+        set_pool_order(Pool_Order_Fn key_fn, int steps_per_update);
+
+        /*
+            How well the pools are lined up with the systems: over every system and every pool of its mask,
+            the share of steps from one entity of the system to the next which move forward in the pool, i.e.
+            walks the prefetcher can follow. 1 means every system walks its pools in order, in archetype
+            storage it always does. Costs a lookup per entity and pool, meant for reports.
+        */
+        f64
+        get_pool_locality() const;
+
+        /*
+            Swaps made and passes completed by { set_pool_order } since it was set.
+        */
+        u64
+        get_pool_order_swap_count() const;
+
+        u64
+        get_pool_order_pass_count() const;
+
+        f64
+        get_critical_path_ms(System_Phase phase) const;
+
         void
         kill_entity(Entity entity);
 
+        /*
+            Get the { Command_Buffer } of the calling thread, which must be part of the { Job_System }. This is
+            how systems running on worker threads make structural changes, they are applied at the start of
+            the next { update }. Commands on entities which were killed in the meantime are skipped.
+        */
+        Command_Buffer&
+        get_commands();
+
+        /*
+            Events which systems, the engine and the frontend send to each other, see { Event_Bus }.
+        */
+        Event_Bus&
+        get_events();
+
         const Component_Mask&
         get_component_mask(Entity entity) const;
+
+    private:
+        void
+        play_back_commands();
+
+        /*
+            Add the new entities to their systems and re-evaluate the entities whose mask changed, the part of
+            { update } which makes the systems agree with the masks.
+        */
+        void
+        sync_systems();
+
+        /*
+            Fill { group_members } from { entity_groups }.
+        */
+        void
+        rebuild_group_members();
+
+        /*
+            Replace a placeholder from a { Command_Buffer } with the entity it was spawned as.
+        */
+        Entity
+        resolve_entity(Entity entity) const;
+
+        /*
+            Set the component of { count } new entities to { value }, the entities must not have it yet and
+            their mask must already include it.
+        */
+        template <typename T_Component>
+        void
+        fill_components(const int* entity_ids, int count, const T_Component& value);
+
+        /*
+            Do the steps of this update towards the order of { set_pool_order }.
+        */
+        void
+        order_pools();
+
+        /*
+            Cut the free ids off the end of the per entity arrays and release their memory, once they are
+            at least a quarter of the ids. The free list is rebuilt in ascending order, so the lowest free ids
+            are used first and the live ids stay packed towards the front. Free ids below the highest live one
+            can't be cut, entity handles hold their id.
+        */
+        void
+        trim_entities();
+
+        /*
+            Free the sparse pages of every pool, system and group which have no entities left on them.
+        */
+        void
+        release_empty_pages();
+
+        /*
+            Give { structure_version } a new value.
+        */
+        void
+        change_structure();
+
+    #if !PROJECT_ECS_STORAGE_ARCHETYPES
+        /*
+            Same as { get_pool } but returns { nullptr } when the pool was never created.
+        */
+        template <typename T_Component>
+        Pool<T_Component>* find_pool() const;
+    #endif
     };
 
 
@@ -98,38 +496,31 @@ namespace jbx {
     */
 
     template <typename T_Component, typename ...T_Component_Args>
-    void Registry::add_component(Entity entity, T_Component_Args&& ...args) {
-        // Get the id's:
-        int component_type_id = Component<T_Component>::get_type_id();
-        int entity_id         = entity.id;
-
-        ERROR_IF(
-            component_type_id >= MAX_COMPONENT_TYPES,
-            "We have exceeded the maximum engine supported unique component types!"
-        );
+    T_Component& Registry::add_component(Entity entity, T_Component_Args&& ...args) {
+        const int entity_id = entity.id;
 
-        // If we are by chance out of the component pool boundaries:
-        if (component_type_id >= component_pools.size())    {
-            component_pools.resize(component_type_id + 1, nullptr);
-        }
+        ERROR_IF(!is_alive(entity), "Stale entity handle given to { add_component }!");
 
-        // If the pool is not initialized, initialize it:
-        if (component_pools[component_type_id] == nullptr) {
-            Shared<Pool<T_Component>> new_component_pool = std::make_shared<Pool<T_Component>>();
-            component_pools[component_type_id]           = new_component_pool;
-        }
-
-        // Get the pool of correct type, component_pools are Base_Pool*.
-        Shared<Pool<T_Component>> component_pool = std::static_pointer_cast<Pool<T_Component>>(
-            component_pools[component_type_id]
+        // Construct the component directly in its storage:
+    #if PROJECT_ECS_STORAGE_ARCHETYPES
+        T_Component& component = component_storage.emplace<T_Component>(
+            entity_id, std::forward<T_Component_Args>(args)...
         );
+    #else
+        T_Component& component = get_pool<T_Component>().emplace(
+            entity_id, std::forward<T_Component_Args>(args)...
+        );
+    #endif
+
+        // Update the component mask for this entity, systems pick up the change in { update }:
+        Component_Mask& mask = component_masks[entity_id];
+        if (!mask.has<T_Component>()) {
+            mask_changes.push_back({ entity, mask });
+            mask.add<T_Component>();
+            change_structure();
+        }
 
-        // Create a new component of this type & add it to the component pool:
-        T_Component new_component(std::forward<T_Component_Args>(args)...);
-        component_pool->set(entity_id, new_component);
-
-        // Update the component mask for this entity:
-        component_masks[entity_id].add<T_Component>();
+        return component;
     }
 
     /*
@@ -138,36 +529,46 @@ namespace jbx {
     */
     template <typename T_Component>
     void Registry::remove_component(Entity entity) {
-        // Get the id's:
-        const int component_type_id = Component<T_Component>::get_type_id();
-        const int entity_id         = entity.id;
-
-        ERROR_IF(
-            component_type_id >= MAX_COMPONENT_TYPES,
-            "We have exceeded the maximum engine supported unique component types!"
-        );
+        const int entity_id = entity.id;
 
-        ERROR_IF(
-            component_masks.size() <= entity_id,
-            "Out of bounds! Entity with the given id is not registered!"
-        );
+        ERROR_IF(!is_alive(entity), "Stale entity handle given to { remove_component }!");
 
         // Remove the component from the component pool for that entity:
-        Shared<Pool<T_Component>> component_pool = std::static_pointer_cast<Pool<T_Component>>(
-            component_pools[component_type_id]
-        );
-        component_pool->remove(entity_id);
+    #if PROJECT_ECS_STORAGE_ARCHETYPES
+        component_storage.remove<T_Component>(entity_id);
+    #else
+        Pool<T_Component>* component_pool = find_pool<T_Component>();
+        if (component_pool != nullptr && component_pool->contains(entity_id)) {
+            component_pool->remove(entity_id);
+        }
+    #endif
+
+        // Clear the bit, systems pick up the change in { update }:
+        Component_Mask& mask = component_masks[entity_id];
+        if (mask.has<T_Component>()) {
+            mask_changes.push_back({ entity, mask });
+            mask.remove<T_Component>();
+            change_structure();
+        }
+    }
+
+    inline bool
+    Registry::is_alive(Entity entity) const {
+        return entity.id >= 0 && entity.id < static_cast<int>(entity_slots.size()) && entity_slots[entity.id] == entity;
+    }
 
-        // Set the bit
-        component_masks[entity_id].remove<T_Component>();
+    inline void
+    Registry::change_structure() {
+        last_structure_version += 1;
+        structure_version       = last_structure_version;
     }
 
     template <typename T_Component>
     T_Component&
     Registry::get_component(Entity entity) {
-        // Get the ids:
-        const int component_type_id = Component<T_Component>::get_type_id();
-        const int entity_id         = entity.id;
+        const int entity_id = entity.id;
+
+        ERROR_IF(!is_alive(entity), "Stale entity handle given to { get_component }!");
 
         // Make sure we have it first:
         ERROR_IF(
@@ -179,11 +580,151 @@ namespace jbx {
             Get the correct pool of components and fetch the instance of the component from the
             pool:
         */
-        Shared<Pool<T_Component>> pool = std::static_pointer_cast<Pool<T_Component>>(
-            component_pools[component_type_id]
-        );
+    #if PROJECT_ECS_STORAGE_ARCHETYPES
+        return component_storage.get<T_Component>(entity_id);
+    #else
+        return find_pool<T_Component>()->get(entity_id);
+    #endif
+    }
 
-        return pool->get(entity_id);
+    template <typename T_Component>
+    void
+    Registry::mark_changed(Entity entity) {
+        ERROR_IF(!is_alive(entity), "Stale entity handle given to { mark_changed }!");
+
+    #if PROJECT_ECS_STORAGE_ARCHETYPES
+        if (component_storage.contains<T_Component>(entity.id)) {
+            component_storage.mark_changed(Component<T_Component>::get_type_id(), entity.id);
+        }
+    #else
+        Pool<T_Component>* pool = find_pool<T_Component>();
+        const int index         = pool != nullptr ? pool->index_of(entity.id) : Sparse_Set::INVALID_INDEX;
+        if (index != Sparse_Set::INVALID_INDEX) {
+            pool->mark_changed(index);
+        }
+    #endif
+    }
+
+    template <typename T_Component>
+    void
+    Registry::mark_changed(const int* entity_ids, int count) {
+    #if PROJECT_ECS_STORAGE_ARCHETYPES
+        constexpr int component_type_id = Component<T_Component>::get_type_id();
+        for (int index = 0; index < count; index++) {
+            component_storage.mark_changed(component_type_id, entity_ids[index]);
+        }
+    #else
+        Pool<T_Component>* pool = find_pool<T_Component>();
+        for (int index = 0; index < count; index++) {
+            pool->mark_changed(pool->index_of(entity_ids[index]));
+        }
+    #endif
+    }
+
+    template <typename T_Component, typename T_Fn>
+    void
+    Registry::each_changed(u32 since_tick, T_Fn&& fn) {
+    #if PROJECT_ECS_STORAGE_ARCHETYPES
+        constexpr int component_type_id = Component<T_Component>::get_type_id();
+
+        for (int index = 0; index < component_storage.get_archetype_count(); index++) {
+            Archetype& archetype = component_storage.get_archetype(index);
+            const int column     = archetype.get_column(component_type_id);
+            if (column == Archetype::NO_COLUMN) {
+                continue;
+            }
+
+            for (int chunk = 0; chunk < archetype.get_chunk_count(); chunk++) {
+                const int* entity_ids         = archetype.get_entity_ids(chunk);
+                const T_Component* components = reinterpret_cast<const T_Component*>(archetype.get_column_data(chunk, column));
+
+                for (int row = 0; row < archetype.get_chunk(chunk).count; row++) {
+                    if (component_storage.get_change_tick(component_type_id, entity_ids[row]) >= since_tick) {
+                        fn(entity_slots[entity_ids[row]], components[row]);
+                    }
+                }
+            }
+        }
+    #else
+        const Pool<T_Component>* pool = find_pool<T_Component>();
+        if (pool == nullptr) {
+            return;
+        }
+
+        // Ticks are contiguous, so skipping unchanged components is a linear scan over 4 bytes each:
+        const u32* ticks              = pool->get_change_ticks();
+        const T_Component* components = pool->get_data();
+        for (int index = 0; index < pool->get_count(); index++) {
+            if (ticks[index] >= since_tick) {
+                fn(entity_slots[pool->get_entity_id(index)], components[index]);
+            }
+        }
+    #endif
+    }
+
+    template <typename T_Component>
+    void
+    Registry::fill_components(const int* entity_ids, int count, const T_Component& value) {
+    #if PROJECT_ECS_STORAGE_ARCHETYPES
+        // The entities were already placed into their archetype, { get } marks the components as changed:
+        for (int index = 0; index < count; index++) {
+            std::memcpy(&component_storage.get<T_Component>(entity_ids[index]), &value, sizeof(T_Component));
+        }
+    #else
+        get_pool<T_Component>().append(entity_ids, count, value);
+    #endif
+    }
+
+    inline u32
+    Registry::get_change_tick() const {
+        return change_tick;
+    }
+
+    template <typename T_Component>
+    Component_Storage<T_Component>&
+    Registry::get_storage() {
+    #if PROJECT_ECS_STORAGE_ARCHETYPES
+        return component_storage.get_column<T_Component>();
+    #else
+        return get_pool<T_Component>();
+    #endif
+    }
+
+#if !PROJECT_ECS_STORAGE_ARCHETYPES
+    template <typename T_Component>
+    Pool<T_Component>&
+    Registry::get_pool() {
+        constexpr int component_type_id = Component<T_Component>::get_type_id();
+
+        // If the pool is not initialized, initialize it:
+        if (component_pools[component_type_id] == nullptr) {
+            component_pools[component_type_id] = std::make_shared<Pool<T_Component>>();
+            component_pools[component_type_id]->set_tick_source(&change_tick);
+        }
+
+        // Pools are only ever created here, so the type is correct unless two components share an id:
+        Base_Pool* pool = component_pools[component_type_id].get();
+        EXPECT(&pool->get_info() == &Component<T_Component>::get_info(), "Two component types share the same id!");
+
+        return *static_cast<Pool<T_Component>*>(pool);
+    }
+
+    template <typename T_Component>
+    Pool<T_Component>*
+    Registry::find_pool() const {
+        constexpr int component_type_id = Component<T_Component>::get_type_id();
+        return static_cast<Pool<T_Component>*>(component_pools[component_type_id].get());
+    }
+#endif // !PROJECT_ECS_STORAGE_ARCHETYPES
+
+    template <typename ...T_Components>
+    View<T_Components...>
+    Registry::view() {
+    #if PROJECT_ECS_STORAGE_ARCHETYPES
+        return View<T_Components...>(component_storage, entity_slots);
+    #else
+        return View<T_Components...>(find_pool<std::remove_const_t<T_Components>>()..., component_masks, entity_slots);
+    #endif
     }
 
     template <typename T_System, typename ...T_System_Args>
@@ -191,8 +732,13 @@ namespace jbx {
         Shared<T_System> new_system = std::make_shared<T_System>(std::forward<T_System_Args>(args)...);
         auto system_type_index      = get_type_index(T_System);
 
-        // Add it to the map:
+        // Commands recorded by systems are played back in the order the systems were added, 0 is "no system":
+        new_system->set_command_scope(static_cast<u32>(systems.size()) + 1);
+        new_system->set_registry(this);
+
+        // Add it to the map, and to the schedule of its phase:
         systems.insert(std::make_pair(system_type_index, new_system));
+        scheduler.add_system(new_system.get(), typeid(T_System).name());
     }
 
     template <typename T_System>
@@ -204,4 +750,70 @@ namespace jbx {
         return system_ref;
     }
 
+    /*
+    ## Command_Buffer: template implementations
+    */
+
+    template <typename T_Component>
+    void
+    Command_Buffer::add_component(Entity entity, const T_Component& component) {
+        static_assert(
+            std::is_trivially_copyable_v<T_Component>,
+            "Only trivially copyable components can be added through a { Command_Buffer }!"
+        );
+        static_assert(alignof(T_Component) <= 16, "Component alignment is not supported by { Command_Buffer }!");
+
+        Command& command = push(Command_Type_Add_Component, entity, static_cast<int>(sizeof(T_Component)));
+        command.apply    = [](Registry& registry, Entity entity, const void* payload) {
+            registry.add_component<T_Component>(entity, *static_cast<const T_Component*>(payload));
+        };
+
+        std::memcpy(command.get_payload(), &component, sizeof(T_Component));
+    }
+
+    template <typename T_Component>
+    void
+    Command_Buffer::remove_component(Entity entity) {
+        Command& command = push(Command_Type_Remove_Component, entity, 0);
+        command.apply    = [](Registry& registry, Entity entity, const void*) {
+            registry.remove_component<T_Component>(entity);
+        };
+    }
+
+    /*
+    ## Prefab: template implementations
+    */
+
+    template <typename T_Component, typename ...T_Component_Args>
+    Prefab&
+    Prefab::add(T_Component_Args&& ...args) {
+        static_assert(
+            std::is_trivially_copyable_v<T_Component>,
+            "Only trivially copyable components can be part of a { Prefab }!"
+        );
+        static_assert(alignof(T_Component) <= 16, "Component alignment is not supported by { Prefab }!");
+
+        const T_Component value(std::forward<T_Component_Args>(args)...);
+
+        // Replace the value if the prefab already has the component:
+        const Prefab_Component* existing = find(Component<T_Component>::get_type_id());
+        const int offset                 = existing != nullptr
+            ? existing->offset
+            : push_value(static_cast<int>(sizeof(T_Component)), static_cast<int>(alignof(T_Component)));
+
+        if (existing == nullptr) {
+            Prefab_Component& component = components.emplace_back();
+            component.info              = &Component<T_Component>::get_info();
+            component.offset            = offset;
+            component.fill              = [](Registry& registry, const int* entity_ids, int count, const void* value) {
+                registry.fill_components<T_Component>(entity_ids, count, *static_cast<const T_Component*>(value));
+            };
+
+            mask.add<T_Component>();
+        }
+
+        std::memcpy(bytes.data() + offset, &value, sizeof(T_Component));
+        return *this;
+    }
+
 } // jbx
@@ -0,0 +1,351 @@
+
+// Implements:
+#include <ecs/Snapshot.hpp>
+
+// Dependencies (3rd party):
+#include <cstdio>
+#if PROJECT_PLATFORM_WIN64
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace jbx {
+
+    /*
+    ## Mapped_File: implementation
+    */
+
+    Mapped_File::~Mapped_File() {
+        close();
+    }
+
+    bool
+    Mapped_File::open(const std::string& file_path) {
+        close();
+
+    #if PROJECT_PLATFORM_WIN64
+        file_handle = CreateFileA(
+            file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr
+        );
+        if (file_handle == INVALID_HANDLE_VALUE) {
+            file_handle = nullptr;
+            return false;
+        }
+
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file_handle, &file_size) || file_size.QuadPart == 0) {
+            close();
+            return false;
+        }
+
+        mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_handle == nullptr) {
+            close();
+            return false;
+        }
+
+        data = static_cast<const u8*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+        size = static_cast<u64>(file_size.QuadPart);
+    #else
+        const int file_descriptor = ::open(file_path.c_str(), O_RDONLY);
+        if (file_descriptor < 0) {
+            return false;
+        }
+
+        struct stat file_stat;
+        if (fstat(file_descriptor, &file_stat) != 0 || file_stat.st_size == 0) {
+            ::close(file_descriptor);
+            return false;
+        }
+
+        // The mapping keeps the file alive, the descriptor is not needed anymore:
+        void* mapping = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+        ::close(file_descriptor);
+
+        data = mapping != MAP_FAILED ? static_cast<const u8*>(mapping) : nullptr;
+        size = static_cast<u64>(file_stat.st_size);
+    #endif
+
+        if (data == nullptr) {
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void
+    Mapped_File::close() {
+    #if PROJECT_PLATFORM_WIN64
+        if (data != nullptr) {
+            UnmapViewOfFile(data);
+        }
+        if (mapping_handle != nullptr) {
+            CloseHandle(mapping_handle);
+        }
+        if (file_handle != nullptr) {
+            CloseHandle(file_handle);
+        }
+
+        mapping_handle = nullptr;
+        file_handle    = nullptr;
+    #else
+        if (data != nullptr) {
+            munmap(const_cast<u8*>(data), size);
+        }
+    #endif
+
+        data = nullptr;
+        size = 0;
+    }
+
+    const u8*
+    Mapped_File::get_data() const {
+        return data;
+    }
+
+    u64
+    Mapped_File::get_size() const {
+        return size;
+    }
+
+    /*
+    ## Snapshot: implementation
+    */
+
+    u64
+    Snapshot::Writer::reserve(u64 size) {
+        const u64 offset = (bytes.size() + SNAPSHOT_ALIGNMENT - 1) & ~(SNAPSHOT_ALIGNMENT - 1);
+        bytes.resize(offset + size, 0);
+
+        return offset;
+    }
+
+    void
+    Snapshot::save_entities(Registry& registry, const Component_Mask& saved_mask, int component_count, Writer& writer) {
+        const u32 entity_count = static_cast<u32>(registry.entity_slots.size());
+
+        // The whole file is at least this big, grow it once:
+        writer.bytes.reserve(
+            sizeof(Snapshot_Header) + entity_count * (sizeof(Entity) + sizeof(Component_Mask)) + 16 * SNAPSHOT_ALIGNMENT
+        );
+
+        const u64 header_offset     = writer.reserve(sizeof(Snapshot_Header));
+        const u64 entities_offset   = writer.reserve(sizeof(Entity) * entity_count);
+        const u64 masks_offset      = writer.reserve(sizeof(Component_Mask) * entity_count);
+        const u64 components_offset = writer.reserve(sizeof(Snapshot_Component) * component_count);
+
+        Snapshot_Header& header  = *writer.at<Snapshot_Header>(header_offset);
+        header.magic             = SNAPSHOT_MAGIC;
+        header.version           = SNAPSHOT_VERSION;
+        header.mask_size         = static_cast<u32>(sizeof(Component_Mask));
+        header.free_entity_id    = registry.free_entity_id;
+        header.entity_count      = entity_count;
+        header.component_count   = static_cast<u32>(component_count);
+        header.entities_offset   = entities_offset;
+        header.masks_offset      = masks_offset;
+        header.components_offset = components_offset;
+
+        if (entity_count == 0) {
+            return;
+        }
+
+        std::memcpy(writer.at<Entity>(entities_offset), registry.entity_slots.data(), sizeof(Entity) * entity_count);
+
+        // Components which are not saved must not be in the masks either:
+        Component_Mask* masks = writer.at<Component_Mask>(masks_offset);
+        for (u32 entity_id = 0; entity_id < entity_count; entity_id++) {
+            masks[entity_id] = registry.component_masks[entity_id] & saved_mask;
+        }
+    }
+
+    void
+    Snapshot::save_groups(Registry& registry, Writer& writer) {
+        const u64 groups_offset = writer.reserve(0);
+
+        u32 group_count = 0;
+        for (int entity_id = 0; entity_id < static_cast<int>(registry.entity_groups.size()); entity_id++) {
+            if (registry.entity_groups[entity_id] == Registry::NO_GROUP) {
+                continue;
+            }
+
+            const std::string& group   = registry.group_names[registry.entity_groups[entity_id]];
+            const Snapshot_Group entry = { entity_id, static_cast<u32>(group.size()) };
+
+            // Entries are only aligned to 4 bytes, they are small and read one at a time:
+            const u64 entry_offset = (writer.bytes.size() + 3) & ~3ull;
+            writer.bytes.resize(entry_offset + sizeof(Snapshot_Group) + group.size(), 0);
+            std::memcpy(writer.bytes.data() + entry_offset, &entry, sizeof(Snapshot_Group));
+            std::memcpy(writer.bytes.data() + entry_offset + sizeof(Snapshot_Group), group.data(), group.size());
+            group_count += 1;
+        }
+
+        Snapshot_Header& header = *writer.at<Snapshot_Header>(0);
+        header.group_count      = group_count;
+        header.groups_offset    = groups_offset;
+        header.file_size        = writer.bytes.size();
+    }
+
+    bool
+    Snapshot::write_file(const std::string& file_path, const std::vector<u8>& bytes) {
+        std::FILE* file = std::fopen(file_path.c_str(), "wb");
+        if (file == nullptr) {
+            log_error("Unable to create the snapshot: {}", file_path);
+            return false;
+        }
+
+        const size_t written = std::fwrite(bytes.data(), 1, bytes.size(), file);
+        const bool closed    = std::fclose(file) == 0;
+
+        if (written != bytes.size() || !closed) {
+            log_error("Unable to write the snapshot: {}", file_path);
+            return false;
+        }
+
+        return true;
+    }
+
+    const Snapshot_Header*
+    Snapshot::validate(const Mapped_File& file, const std::string& file_path) {
+        const u64 file_size = file.get_size();
+
+        // Sections must be inside of the file, sizes are 32 bit so this can't overflow:
+        auto is_inside = [file_size](u64 offset, u64 size) {
+            return offset <= file_size && size <= file_size - offset;
+        };
+
+        if (!is_inside(0, sizeof(Snapshot_Header))) {
+            log_error("Snapshot {} is too small", file_path);
+            return nullptr;
+        }
+
+        const Snapshot_Header* header = reinterpret_cast<const Snapshot_Header*>(file.get_data());
+        if (header->magic != SNAPSHOT_MAGIC || header->version != SNAPSHOT_VERSION) {
+            log_error("Snapshot {} is not a snapshot, or its version is not supported", file_path);
+            return nullptr;
+        }
+
+        if (header->mask_size != sizeof(Component_Mask)) {
+            log_error("Snapshot {} was saved with a different {{ PROJECT_ECS_MAX_COMPONENT_TYPES }}", file_path);
+            return nullptr;
+        }
+
+        bool valid = header->file_size <= file_size
+                  && is_inside(header->entities_offset, static_cast<u64>(header->entity_count) * sizeof(Entity))
+                  && is_inside(header->masks_offset, static_cast<u64>(header->entity_count) * sizeof(Component_Mask))
+                  && is_inside(header->components_offset, static_cast<u64>(header->component_count) * sizeof(Snapshot_Component))
+                  && is_inside(header->groups_offset, 0);
+
+        const Snapshot_Component* components = valid
+            ? reinterpret_cast<const Snapshot_Component*>(file.get_data() + header->components_offset)
+            : nullptr;
+
+        for (u32 index = 0; valid && index < header->component_count; index++) {
+            const Snapshot_Component& component = components[index];
+            valid = component.type_id < MAX_COMPONENT_TYPES
+                 && is_inside(component.entity_ids_offset, static_cast<u64>(component.count) * sizeof(int))
+                 && is_inside(component.data_offset, static_cast<u64>(component.count) * component.size);
+        }
+
+        // Groups are variable size, walk through all of them:
+        u64 group_offset = header->groups_offset;
+        for (u32 index = 0; valid && index < header->group_count; index++) {
+            group_offset = (group_offset + 3) & ~3ull;
+            valid        = is_inside(group_offset, sizeof(Snapshot_Group));
+            if (valid) {
+                const Snapshot_Group* group = reinterpret_cast<const Snapshot_Group*>(file.get_data() + group_offset);
+                valid         = is_inside(group_offset + sizeof(Snapshot_Group), group->name_length);
+                group_offset += sizeof(Snapshot_Group) + group->name_length;
+            }
+        }
+
+        if (!valid) {
+            log_error("Snapshot {} is truncated or corrupted", file_path);
+            return nullptr;
+        }
+
+        return header;
+    }
+
+    const Snapshot_Component*
+    Snapshot::find_component(const Mapped_File& file, int component_type_id) {
+        const Snapshot_Header* header        = reinterpret_cast<const Snapshot_Header*>(file.get_data());
+        const Snapshot_Component* components = reinterpret_cast<const Snapshot_Component*>(
+            file.get_data() + header->components_offset
+        );
+
+        for (u32 index = 0; index < header->component_count; index++) {
+            if (components[index].type_id == static_cast<u32>(component_type_id)) {
+                return &components[index];
+            }
+        }
+
+        return nullptr;
+    }
+
+    void
+    Snapshot::load_entities(Registry& registry, const Mapped_File& file, const Component_Mask& loaded_mask) {
+        const Snapshot_Header* header = reinterpret_cast<const Snapshot_Header*>(file.get_data());
+        const u32 entity_count        = header->entity_count;
+        const Entity* entity_slots    = reinterpret_cast<const Entity*>(file.get_data() + header->entities_offset);
+        const Component_Mask* masks   = reinterpret_cast<const Component_Mask*>(file.get_data() + header->masks_offset);
+
+        registry.entity_slots.assign(entity_slots, entity_slots + entity_count);
+        registry.component_masks.assign(masks, masks + entity_count);
+        registry.entity_groups.assign(entity_count, Registry::NO_GROUP);
+        registry.free_entity_id = header->free_entity_id;
+        registry.change_structure();
+
+        // Only when the snapshot has components which are not loaded, their bits must go:
+        const Snapshot_Component* components = reinterpret_cast<const Snapshot_Component*>(
+            file.get_data() + header->components_offset
+        );
+
+        Component_Mask saved_mask;
+        for (u32 index = 0; index < header->component_count; index++) {
+            saved_mask.set(static_cast<int>(components[index].type_id));
+        }
+
+        if ((saved_mask & loaded_mask) != saved_mask) {
+            for (Component_Mask& mask: registry.component_masks) {
+                mask = mask & loaded_mask;
+            }
+        }
+
+        // Living entities are the ones whose slot points to itself, the rest are in the free list:
+        registry.new_entities.reserve(registry.new_entities.size() + entity_count);
+        for (u32 entity_id = 0; entity_id < entity_count; entity_id++) {
+            const Entity& entity = registry.entity_slots[entity_id];
+            if (entity.id != static_cast<int>(entity_id)) {
+                continue;
+            }
+
+            registry.new_entities.push_back(entity);
+
+        #if PROJECT_ECS_STORAGE_ARCHETYPES
+            if (registry.component_masks[entity_id] != Component_Mask()) {
+                registry.component_storage.insert_entity(entity.id, registry.component_masks[entity_id]);
+            }
+        #endif
+        }
+
+        // Groups:
+        u64 group_offset = header->groups_offset;
+        for (u32 index = 0; index < header->group_count; index++) {
+            group_offset = (group_offset + 3) & ~3ull;
+
+            const Snapshot_Group* group = reinterpret_cast<const Snapshot_Group*>(file.get_data() + group_offset);
+            const char* name            = reinterpret_cast<const char*>(group + 1);
+            group_offset               += sizeof(Snapshot_Group) + group->name_length;
+
+            if (group->entity_id >= 0 && group->entity_id < static_cast<int>(entity_count)) {
+                registry.group_entity(registry.entity_slots[group->entity_id], std::string(name, group->name_length));
+            }
+        }
+    }
+
+} // jbx
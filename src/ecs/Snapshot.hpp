@@ -0,0 +1,348 @@
+
+#pragma once
+
+#include <ecs/Registry.hpp>
+
+// Dependencies (3rd party):
+#include <type_traits>
+#include <cstring>
+
+namespace jbx {
+
+    /*
+        Snapshot file layout, version { SNAPSHOT_VERSION }. Every section starts at a multiple of
+        { SNAPSHOT_ALIGNMENT } bytes from the start of the file, so it can be used in place once the file is
+        mapped into memory:
+
+            Snapshot_Header
+            Entity[entity_count]              entity slots, including the free list
+            Component_Mask[entity_count]      masks, only bits of the saved components
+            Snapshot_Component[component_count]
+            per component: int[count]         entity ids, in dense order
+                           T[count]           components, in the same order
+            per group entry: Snapshot_Group + name (not terminated)
+
+        Nothing is converted on load, so snapshots are only compatible with builds of the same endianness,
+        { PROJECT_ECS_MAX_COMPONENT_TYPES } and component layouts (checked with { mask_size } and the size
+        of every component).
+    */
+    constexpr u32 SNAPSHOT_MAGIC     = 0x53535643; // "CVSS"
+    constexpr u32 SNAPSHOT_VERSION   = 1;
+    constexpr u64 SNAPSHOT_ALIGNMENT = 64;
+
+    struct Snapshot_Header {
+        u32 magic;
+        u32 version;
+        u32 mask_size;
+        s32 free_entity_id;
+        u32 entity_count;
+        u32 component_count;
+        u32 group_count;
+        u32 reserved;
+        u64 entities_offset;
+        u64 masks_offset;
+        u64 components_offset;
+        u64 groups_offset;
+        u64 file_size;
+    };
+
+    struct Snapshot_Component {
+        u32 type_id;
+        u32 size;
+        u32 count;
+        u32 reserved;
+        u64 entity_ids_offset;
+        u64 data_offset;
+    };
+
+    struct Snapshot_Group {
+        s32 entity_id;
+        u32 name_length;
+    };
+
+    /*
+        Read only view of a whole file mapped into memory, unmapped when destroyed.
+    */
+    class Mapped_File final {
+    private:
+        const u8* data = nullptr;
+        u64       size = 0;
+
+    #if PROJECT_PLATFORM_WIN64
+        void*     file_handle    = nullptr;
+        void*     mapping_handle = nullptr;
+    #endif
+
+    public:
+        Mapped_File() = default;
+        ~Mapped_File();
+
+        Mapped_File(const Mapped_File&)            = delete;
+        Mapped_File& operator=(const Mapped_File&) = delete;
+
+        /*
+            Map the file, returns false if it does not exist or can't be mapped.
+        */
+        bool
+        open(const std::string& file_path);
+
+        void
+        close();
+
+        const u8*
+        get_data() const;
+
+        u64
+        get_size() const;
+    };
+
+    /*
+        { Snapshot } saves the whole { Registry } into a binary file and loads it back: entity slots (with
+        the free ids), component masks, groups and the dense array of every given component type.
+
+        Usage:
+            Snapshot::save<Rect, Color, Velocity>(registry, "level.snapshot");
+            Snapshot::load<Rect, Color, Velocity>(registry, "level.snapshot");
+
+        Components are stored exactly as they are in memory, so only trivially copyable components can be
+        saved. Components of other types are left out, as are their bits in the masks.
+
+        Saving builds the file in memory and writes it with a single call. Loading maps the file and copies
+        each pool with a single copy, the only per-entity work is filling in the sparse pages (or the
+        archetype rows). Entities are added to systems on the next { Registry::update }.
+
+        Loading is only supported into a registry without entities, commands and systems are not saved.
+        Errors with the file (missing, truncated, saved by an incompatible build) are logged and { false } is
+        returned, the registry is left untouched.
+    */
+    class Snapshot final {
+    public:
+        template <typename ...T_Components>
+        static bool
+        save(Registry& registry, const std::string& file_path);
+
+        template <typename ...T_Components>
+        static bool
+        load(Registry& registry, const std::string& file_path);
+
+    private:
+        /*
+            The file being saved, sections are reserved zeroed and filled in afterwards. Use offsets rather
+            than pointers, { bytes } may move when it grows.
+        */
+        struct Writer {
+            std::vector<u8> bytes;
+
+            u64
+            reserve(u64 size);
+
+            template <typename T>
+            T*
+            at(u64 offset);
+        };
+
+        /*
+            Header, entity slots and masks, reserves the table of { component_count } components.
+        */
+        static void
+        save_entities(Registry& registry, const Component_Mask& saved_mask, int component_count, Writer& writer);
+
+        /*
+            Groups, then completes the header.
+        */
+        static void
+        save_groups(Registry& registry, Writer& writer);
+
+        static bool
+        write_file(const std::string& file_path, const std::vector<u8>& bytes);
+
+        /*
+            Check that every section is inside the file and it was saved by a compatible build, returns
+            { nullptr } (and logs why) if the file can't be loaded.
+        */
+        static const Snapshot_Header*
+        validate(const Mapped_File& file, const std::string& file_path);
+
+        /*
+            Section of the given component type, or { nullptr } if the snapshot does not have it.
+        */
+        static const Snapshot_Component*
+        find_component(const Mapped_File& file, int component_type_id);
+
+        /*
+            Entity slots, masks (limited to { loaded_mask }) and groups. In archetype mode every entity is
+            placed into its archetype, which is why the loaded component types must be registered first.
+        */
+        static void
+        load_entities(Registry& registry, const Mapped_File& file, const Component_Mask& loaded_mask);
+
+        template <typename T>
+        static void
+        save_component(Registry& registry, int component_index, Writer& writer);
+
+        template <typename T>
+        static bool
+        check_component(const Mapped_File& file, const std::string& file_path);
+
+        template <typename T>
+        static void
+        load_component(Registry& registry, const Mapped_File& file);
+    };
+
+    /*
+    ## Snapshot: template implementations
+    */
+
+    template <typename T>
+    T*
+    Snapshot::Writer::at(u64 offset) {
+        return reinterpret_cast<T*>(bytes.data() + offset);
+    }
+
+    template <typename ...T_Components>
+    bool
+    Snapshot::save(Registry& registry, const std::string& file_path) {
+        static_assert(
+            (std::is_trivially_copyable_v<T_Components> && ...),
+            "Only trivially copyable components can be saved in a { Snapshot }!"
+        );
+
+        Component_Mask saved_mask;
+        (saved_mask.add<T_Components>(), ...);
+
+        Writer writer;
+        save_entities(registry, saved_mask, static_cast<int>(sizeof...(T_Components)), writer);
+
+        int component_index = 0;
+        (save_component<T_Components>(registry, component_index++, writer), ...);
+
+        save_groups(registry, writer);
+        return write_file(file_path, writer.bytes);
+    }
+
+    template <typename ...T_Components>
+    bool
+    Snapshot::load(Registry& registry, const std::string& file_path) {
+        static_assert(
+            (std::is_trivially_copyable_v<T_Components> && ...),
+            "Only trivially copyable components can be loaded from a { Snapshot }!"
+        );
+
+        ERROR_IF(!registry.entity_slots.empty(), "Snapshots can only be loaded into a registry without entities!");
+
+        Mapped_File file;
+        if (!file.open(file_path)) {
+            log_error("Unable to open the snapshot: {}", file_path);
+            return false;
+        }
+
+        // Check everything before the registry is touched:
+        if (validate(file, file_path) == nullptr || !(check_component<T_Components>(file, file_path) && ...)) {
+            return false;
+        }
+
+        Component_Mask loaded_mask;
+        (loaded_mask.add<T_Components>(), ...);
+
+    #if PROJECT_ECS_STORAGE_ARCHETYPES
+        (registry.component_storage.register_component(Component<T_Components>::get_info()), ...);
+    #endif
+
+        load_entities(registry, file, loaded_mask);
+        (load_component<T_Components>(registry, file), ...);
+
+        return true;
+    }
+
+    template <typename T>
+    void
+    Snapshot::save_component(Registry& registry, int component_index, Writer& writer) {
+        // Count first, so the ids and the data can each be a single contiguous section:
+    #if PROJECT_ECS_STORAGE_ARCHETYPES
+        Archetype_Storage& storage = registry.component_storage;
+        int count = 0;
+        for (int index = 0; index < storage.get_archetype_count(); index++) {
+            Archetype& archetype = storage.get_archetype(index);
+            if (archetype.get_column(Component<T>::get_type_id()) != Archetype::NO_COLUMN) {
+                count += archetype.get_entity_count();
+            }
+        }
+    #else
+        const Pool<T>* pool = registry.find_pool<T>();
+        const int count     = pool != nullptr ? pool->get_count() : 0;
+    #endif
+
+        const u64 entity_ids_offset = writer.reserve(sizeof(int) * count);
+        const u64 data_offset       = writer.reserve(sizeof(T) * count);
+
+    #if PROJECT_ECS_STORAGE_ARCHETYPES
+        int written = 0;
+        for (int index = 0; index < storage.get_archetype_count(); index++) {
+            Archetype& archetype = storage.get_archetype(index);
+            const int column     = archetype.get_column(Component<T>::get_type_id());
+            if (column == Archetype::NO_COLUMN) {
+                continue;
+            }
+
+            for (int chunk = 0; chunk < archetype.get_chunk_count(); chunk++) {
+                const int chunk_count = archetype.get_chunk(chunk).count;
+                std::memcpy(writer.at<int>(entity_ids_offset) + written, archetype.get_entity_ids(chunk), sizeof(int) * chunk_count);
+                std::memcpy(writer.at<T>(data_offset) + written, archetype.get_column_data(chunk, column), sizeof(T) * chunk_count);
+                written += chunk_count;
+            }
+        }
+    #else
+        if (count > 0) {
+            std::memcpy(writer.at<int>(entity_ids_offset), pool->get_entity_ids(), sizeof(int) * count);
+            std::memcpy(writer.at<T>(data_offset), pool->get_data(), sizeof(T) * count);
+        }
+    #endif
+
+        const Snapshot_Header* header = writer.at<Snapshot_Header>(0);
+        Snapshot_Component& component = writer.at<Snapshot_Component>(header->components_offset)[component_index];
+        component.type_id             = static_cast<u32>(Component<T>::get_type_id());
+        component.size                = static_cast<u32>(sizeof(T));
+        component.count               = static_cast<u32>(count);
+        component.entity_ids_offset   = entity_ids_offset;
+        component.data_offset         = data_offset;
+    }
+
+    template <typename T>
+    bool
+    Snapshot::check_component(const Mapped_File& file, const std::string& file_path) {
+        const Snapshot_Component* component = find_component(file, Component<T>::get_type_id());
+        if (component != nullptr && component->size != sizeof(T)) {
+            log_error(
+                "Snapshot {} was saved with a different {{ {} }}: {} bytes, expected {}",
+                file_path, Component<T>::get_name(), component->size, sizeof(T)
+            );
+            return false;
+        }
+
+        return true;
+    }
+
+    template <typename T>
+    void
+    Snapshot::load_component(Registry& registry, const Mapped_File& file) {
+        const Snapshot_Component* component = find_component(file, Component<T>::get_type_id());
+        if (component == nullptr || component->count == 0) {
+            return;
+        }
+
+        const int count       = static_cast<int>(component->count);
+        const int* entity_ids = reinterpret_cast<const int*>(file.get_data() + component->entity_ids_offset);
+        const T* data         = reinterpret_cast<const T*>(file.get_data() + component->data_offset);
+
+    #if PROJECT_ECS_STORAGE_ARCHETYPES
+        // Rows were created by { load_entities }, the components are copied into them:
+        Archetype_Storage& storage = registry.component_storage;
+        for (int index = 0; index < count; index++) {
+            std::memcpy(&storage.get<T>(entity_ids[index]), data + index, sizeof(T));
+        }
+    #else
+        registry.get_pool<T>().assign(entity_ids, data, count);
+    #endif
+    }
+
+} // jbx
@@ -0,0 +1,167 @@
+
+// Implements:
+#include <ecs/Sparse_Set.hpp>
+
+// Dependencies (3rd party):
+#include <algorithm>
+
+namespace jbx {
+
+    int&
+    Sparse_Set::get_or_create_slot(int entity_id) {
+        const size_t page = static_cast<size_t>(entity_id) / PAGE_SIZE;
+        if (page >= sparse.size()) {
+            sparse.resize(page + 1);
+            page_counts.resize(page + 1, 0);
+        }
+
+        // Allocate the page and mark every slot as empty:
+        if (sparse[page] == nullptr) {
+            sparse[page] = std::make_unique<int[]>(PAGE_SIZE);
+            std::fill_n(sparse[page].get(), PAGE_SIZE, INVALID_INDEX);
+        }
+
+        page_counts[page] += 1;
+        return sparse[page][entity_id % PAGE_SIZE];
+    }
+
+    void
+    Sparse_Set::release_slot(int entity_id) {
+        const size_t page = static_cast<size_t>(entity_id) / PAGE_SIZE;
+        sparse[page][entity_id % PAGE_SIZE] = INVALID_INDEX;
+
+        page_counts[page] -= 1;
+    }
+
+    int
+    Sparse_Set::insert(int entity_id) {
+        ERROR_IF(entity_id < 0, "Invalid entity id given to { Sparse_Set.insert() }.");
+
+        int& slot = get_or_create_slot(entity_id);
+        ERROR_IF(slot != INVALID_INDEX, "Entity is already in the set!");
+
+        slot = static_cast<int>(dense.size());
+        dense.push_back(entity_id);
+
+        return slot;
+    }
+
+    int
+    Sparse_Set::swap_remove(int entity_id) {
+        int* page = get_page(entity_id);
+        ERROR_IF(page == nullptr || page[entity_id % PAGE_SIZE] == INVALID_INDEX, "Entity is not in the set!");
+
+        const int index_of_removed = page[entity_id % PAGE_SIZE];
+        const int entity_id_of_last = dense.back();
+
+        // Move the last entity into the vacated slot:
+        dense[index_of_removed] = entity_id_of_last;
+        get_page(entity_id_of_last)[entity_id_of_last % PAGE_SIZE] = index_of_removed;
+
+        // Shrink:
+        dense.pop_back();
+        release_slot(entity_id);
+
+        return index_of_removed;
+    }
+
+    void
+    Sparse_Set::swap_indices(int index_a, int index_b) {
+        const int entity_id_a = dense[index_a];
+        const int entity_id_b = dense[index_b];
+
+        dense[index_a] = entity_id_b;
+        dense[index_b] = entity_id_a;
+        get_page(entity_id_a)[entity_id_a % PAGE_SIZE] = index_b;
+        get_page(entity_id_b)[entity_id_b % PAGE_SIZE] = index_a;
+    }
+
+    void
+    Sparse_Set::assign(const int* entity_ids, int count) {
+        // Empty the slots but keep the pages, usually the same entities are assigned in a different order:
+        for (int entity_id: dense) {
+            get_page(entity_id)[entity_id % PAGE_SIZE] = INVALID_INDEX;
+        }
+        std::fill(page_counts.begin(), page_counts.end(), 0);
+        dense.assign(entity_ids, entity_ids + count);
+
+        for (int index = 0; index < count; index++) {
+            int& slot = get_or_create_slot(entity_ids[index]);
+            ERROR_IF(slot != INVALID_INDEX, "Entity is already in the set!");
+
+            slot = index;
+        }
+
+    }
+
+    void
+    Sparse_Set::append(const int* entity_ids, int count) {
+        const int first_index = static_cast<int>(dense.size());
+        dense.insert(dense.end(), entity_ids, entity_ids + count);
+
+        for (int index = 0; index < count; index++) {
+            int& slot = get_or_create_slot(entity_ids[index]);
+            ERROR_IF(slot != INVALID_INDEX, "Entity is already in the set!");
+
+            slot = first_index + index;
+        }
+    }
+
+    void
+    Sparse_Set::clear() {
+        sparse.clear();
+        page_counts.clear();
+        dense.clear();
+    }
+
+    void
+    Sparse_Set::reserve(int capacity) {
+        dense.reserve(capacity);
+    }
+
+    bool
+    Sparse_Set::is_oversized() const {
+        return dense.capacity() > MIN_SHRINK_CAPACITY && dense.size() * 4 < dense.capacity();
+    }
+
+    void
+    Sparse_Set::release_empty_pages() {
+        for (size_t page = 0; page < sparse.size(); page++) {
+            if (page_counts[page] == 0) {
+                sparse[page].reset();
+            }
+        }
+
+        // Drop the empty pages at the end of the table too:
+        while (!sparse.empty() && sparse.back() == nullptr) {
+            sparse.pop_back();
+            page_counts.pop_back();
+        }
+    }
+
+    void
+    Sparse_Set::shrink_to_fit() {
+        dense.shrink_to_fit();
+        sparse.shrink_to_fit();
+        page_counts.shrink_to_fit();
+    }
+
+    int
+    Sparse_Set::get_page_count() const {
+        return static_cast<int>(std::count_if(sparse.begin(), sparse.end(), [](const Unique<int[]>& page) {
+            return page != nullptr;
+        }));
+    }
+
+    u64
+    Sparse_Set::get_dense_bytes() const {
+        return dense.capacity() * sizeof(int);
+    }
+
+    u64
+    Sparse_Set::get_sparse_bytes() const {
+        const u64 table_bytes = sparse.capacity() * sizeof(Unique<int[]>) + page_counts.capacity() * sizeof(int);
+        return table_bytes + static_cast<u64>(get_page_count()) * PAGE_SIZE * sizeof(int);
+    }
+
+} // jbx
@@ -0,0 +1,197 @@
+
+#pragma once
+
+namespace jbx {
+
+    /*
+        { Sparse_Set } maps entity ids to a dense range of indices { 0..count }, and back.
+
+        - { sparse }: paged array indexed by the entity id, holds the dense index (or { INVALID_INDEX }).
+          Pages of { PAGE_SIZE } entries are allocated on demand, so large ids do not allocate the whole
+          range up front. { page_counts } tracks how many ids of every page are in the set, empty pages
+          are kept until { release_empty_pages }, so an entity which keeps joining and leaving the set does
+          not reallocate its page every time.
+        - { dense }: entity id for every dense index, contiguous.
+
+        Every lookup is two array loads, no hashing. Removal is a swap with the last element, callers which
+        keep data parallel to { dense } must mirror that swap (see { Pool }).
+    */
+    class Sparse_Set final {
+    public:
+        static constexpr int PAGE_SIZE     = 4096;
+        static constexpr int INVALID_INDEX = -1;
+
+        // Dense ranges smaller than this are never considered oversized, see { is_oversized }:
+        static constexpr int MIN_SHRINK_CAPACITY = 1024;
+
+    private:
+        std::vector<Unique<int[]>> sparse;
+        std::vector<int>           page_counts;
+        std::vector<int>           dense;
+
+    public:
+        Sparse_Set()  = default;
+        ~Sparse_Set() = default;
+
+        Sparse_Set(Sparse_Set&&)            = default;
+        Sparse_Set& operator=(Sparse_Set&&) = default;
+
+        /*
+            Check if the entity with the given id is in the set.
+        */
+        bool
+        contains(int entity_id) const;
+
+        /*
+            Get the dense index of the entity, or { INVALID_INDEX } if it's not in the set.
+        */
+        int
+        index_of(int entity_id) const;
+
+        /*
+            Add the entity to the end of the dense range and return its index, entity must not be in the set.
+        */
+        int
+        insert(int entity_id);
+
+        /*
+            Remove the entity from the set by moving the last entity into its place. Returns the index which
+            was vacated, which is where the last element now lives. Entity must be in the set.
+        */
+        int
+        swap_remove(int entity_id);
+
+        /*
+            Exchange the entities at the two dense indices, callers which keep data parallel to { dense } must
+            mirror the swap.
+        */
+        void
+        swap_indices(int index_a, int index_b);
+
+        /*
+            Get the entity id stored at the given dense index.
+        */
+        int
+        entity_at(int index) const;
+
+        int
+        get_count() const;
+
+        const std::vector<int>&
+        get_dense() const;
+
+        /*
+            Replace the contents of the set with { entity_ids }, in that order. Used to load the set in bulk,
+            ids must be unique.
+        */
+        void
+        assign(const int* entity_ids, int count);
+
+        /*
+            Add { entity_ids } to the end of the dense range, in that order. None of them may be in the set, ids
+            must be unique. Used to add entities in bulk, the dense range grows at most once.
+        */
+        void
+        append(const int* entity_ids, int count);
+
+        void
+        clear();
+
+        /*
+            Reserve room for { capacity } entities in the dense range.
+        */
+        void
+        reserve(int capacity);
+
+        /*
+            Check if less than a quarter of the dense capacity is used, e.g. after a spike of entities was
+            killed. Shrinking only then keeps adding and removing amortized O(1).
+        */
+        bool
+        is_oversized() const;
+
+        /*
+            Release the unused capacity of the dense range.
+        */
+        void
+        shrink_to_fit();
+
+        /*
+            Free the pages none of whose ids are in the set, called now and then by the { Registry }, see
+            { Registry::trim_entities }.
+        */
+        void
+        release_empty_pages();
+
+        /*
+            Number of sparse pages currently allocated.
+        */
+        int
+        get_page_count() const;
+
+        /*
+            Memory held by the dense range and the sparse pages, in bytes.
+        */
+        u64
+        get_dense_bytes() const;
+
+        u64
+        get_sparse_bytes() const;
+
+    private:
+        int*
+        get_page(int entity_id) const;
+
+        /*
+            Get the slot of an entity which is being inserted, allocating its page if needed. The page counts
+            the entity from here on, see { release_slot }.
+        */
+        int&
+        get_or_create_slot(int entity_id);
+
+        /*
+            Clear the slot of an entity which left the set, its page stays allocated even when it's empty.
+        */
+        void
+        release_slot(int entity_id);
+    };
+
+    /*
+    ## Sparse_Set: inline implementations
+
+        These are on the hot path of every component access, so they live in the header.
+    */
+
+    inline int*
+    Sparse_Set::get_page(int entity_id) const {
+        const size_t page = static_cast<size_t>(entity_id) / PAGE_SIZE;
+        return page < sparse.size() ? sparse[page].get() : nullptr;
+    }
+
+    inline bool
+    Sparse_Set::contains(int entity_id) const {
+        return index_of(entity_id) != INVALID_INDEX;
+    }
+
+    inline int
+    Sparse_Set::index_of(int entity_id) const {
+        const int* page = get_page(entity_id);
+        return page != nullptr ? page[entity_id % PAGE_SIZE] : INVALID_INDEX;
+    }
+
+    inline int
+    Sparse_Set::entity_at(int index) const {
+        return dense[index];
+    }
+
+    inline int
+    Sparse_Set::get_count() const {
+        return static_cast<int>(dense.size());
+    }
+
+    inline const std::vector<int>&
+    Sparse_Set::get_dense() const {
+        return dense;
+    }
+
+} // jbx
@@ -0,0 +1,172 @@
+
+// Implements:
+#include <ecs/System_Scheduler.hpp>
+
+// Dependencies (3rd party):
+#include <algorithm>
+
+namespace jbx {
+
+    void
+    System_Scheduler::add_system(Base_System* system, const std::string& name) {
+        std::vector<Node>& graph = graphs[system->get_phase()];
+
+        Node node = { system, {}, {}, 0 };
+        const int node_index = static_cast<int>(graph.size());
+
+        // Depend on every earlier system of the phase we conflict with:
+        for (int other_index = 0; other_index < node_index; other_index++) {
+            if (system->conflicts_with(*graph[other_index].system)) {
+                node.dependencies.push_back(other_index);
+                graph[other_index].dependents.push_back(node_index);
+            }
+        }
+
+        graph.push_back(std::move(node));
+
+        System_Timing timing = {};
+        timing.name = name;
+        timings[system->get_phase()].push_back(timing);
+    }
+
+    void
+    System_Scheduler::push_ready(int node_index, std::vector<int>& ready_jobs) {
+        const Node& node = (*running_graph)[node_index];
+
+        if (node.system->get_flags() & System_Flags_Main_Thread) {
+            ready_main.push_back(node_index);
+            work_done.notify_all();
+        } else {
+            ready_jobs.push_back(node_index);
+        }
+    }
+
+    void
+    System_Scheduler::schedule(const std::vector<int>& ready_jobs) {
+        Unique<Job_System>& job_system = get_context<Job_System>();
+
+        for (int node_index: ready_jobs) {
+            job_system->run([this, node_index] { execute(node_index); });
+        }
+    }
+
+    void
+    System_Scheduler::execute(int node_index) {
+        Node& node       = (*running_graph)[node_index];
+        const auto start = std::chrono::steady_clock::now();
+        {
+            Command_Order_Scope order(node.system->get_command_scope(), 0);
+            node.system->update(running_delta);
+        }
+        const auto end   = std::chrono::steady_clock::now();
+
+        std::vector<int> ready_jobs;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+
+            System_Timing& timing = timings[node.system->get_phase()][node_index];
+            timing.start_ms       = std::chrono::duration<f64, std::milli>(start - phase_start).count();
+            timing.duration_ms    = std::chrono::duration<f64, std::milli>(end - start).count();
+            timing.thread_index   = get_context<Job_System>()->get_thread_index();
+
+            for (int dependent: node.dependents) {
+                Node& dependent_node = (*running_graph)[dependent];
+                dependent_node.remaining -= 1;
+                if (dependent_node.remaining == 0) {
+                    push_ready(dependent, ready_jobs);
+                }
+            }
+
+            completed_count += 1;
+            work_done.notify_all();
+        }
+
+        // Outside of the lock, the job system may run the job right away:
+        schedule(ready_jobs);
+    }
+
+    void
+    System_Scheduler::run(System_Phase phase, f64 delta_time) {
+        std::vector<Node>& graph = graphs[phase];
+        const int node_count     = static_cast<int>(graph.size());
+        if (node_count == 0) {
+            return;
+        }
+
+        Unique<Job_System>& job_system = get_context<Job_System>();
+
+        std::vector<int> ready_jobs;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            running_graph   = &graph;
+            running_delta   = delta_time;
+            completed_count = 0;
+            phase_start     = std::chrono::steady_clock::now();
+
+            for (Node& node: graph) {
+                node.remaining = static_cast<int>(node.dependencies.size());
+            }
+            for (int node_index = 0; node_index < node_count; node_index++) {
+                if (graph[node_index].remaining == 0) {
+                    push_ready(node_index, ready_jobs);
+                }
+            }
+        }
+        schedule(ready_jobs);
+
+        // The main thread takes pinned systems first, then helps with the rest:
+        while (true) {
+            std::unique_lock<std::mutex> held_lock(lock);
+            if (completed_count == node_count) {
+                break;
+            }
+
+            if (!ready_main.empty()) {
+                const int node_index = ready_main.front();
+                ready_main.pop_front();
+                held_lock.unlock();
+
+                execute(node_index);
+                continue;
+            }
+
+            held_lock.unlock();
+            if (!job_system->execute_one()) {
+                held_lock.lock();
+                work_done.wait_for(held_lock, std::chrono::microseconds(100), [&] {
+                    return completed_count == node_count || !ready_main.empty();
+                });
+            }
+        }
+
+        running_graph = nullptr;
+    }
+
+    const std::vector<System_Timing>&
+    System_Scheduler::get_timings(System_Phase phase) const {
+        return timings[phase];
+    }
+
+    f64
+    System_Scheduler::get_critical_path_ms(System_Phase phase) const {
+        const std::vector<Node>& graph = graphs[phase];
+        const std::vector<System_Timing>& phase_timings = timings[phase];
+
+        // Dependencies always point to earlier nodes, so index order is a topological order:
+        std::vector<f64> path_ms(graph.size(), 0.0);
+        f64 longest_ms = 0.0;
+
+        for (size_t node_index = 0; node_index < graph.size(); node_index++) {
+            f64 longest_dependency_ms = 0.0;
+            for (int dependency: graph[node_index].dependencies) {
+                longest_dependency_ms = std::max(longest_dependency_ms, path_ms[dependency]);
+            }
+
+            path_ms[node_index] = longest_dependency_ms + phase_timings[node_index].duration_ms;
+            longest_ms          = std::max(longest_ms, path_ms[node_index]);
+        }
+
+        return longest_ms;
+    }
+
+} // jbx
@@ -0,0 +1,105 @@
+
+#pragma once
+
+#include <ecs/Base_System.hpp>
+#include <engine/core/job_system.hpp>
+
+// Dependencies (3rd party):
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <chrono>
+
+namespace jbx {
+
+    /*
+        Timing of a single system from the last { System_Scheduler::run }, relative to the start of the phase.
+    */
+    struct System_Timing {
+        std::string name;
+        f64         start_ms;
+        f64         duration_ms;
+        int         thread_index; // See { Job_System::get_thread_index }.
+    };
+
+    /*
+        { System_Scheduler } runs the systems of a phase as a dependency graph, instead of one after another.
+
+        System { j } depends on an earlier registered system { i } of the same phase if they conflict, see
+        { Base_System::conflicts_with }, so registration order is kept wherever it matters (e.g. draw order)
+        and systems which touch different components run at the same time. The graph only depends on the
+        declarations, so it's rebuilt when a system is added instead of every frame.
+
+        Ready systems are scheduled as jobs on the { Job_System }, systems with { System_Flags_Main_Thread }
+        are queued for the main thread instead, which executes other jobs while it waits for them. { run }
+        returns once every system of the phase is done.
+    */
+    class System_Scheduler final {
+    private:
+        struct Node {
+            Base_System*     system;
+            std::vector<int> dependencies;
+            std::vector<int> dependents;
+            int              remaining;
+        };
+
+        std::vector<Node>          graphs[System_Phase_Count];
+        std::vector<System_Timing> timings[System_Phase_Count];
+
+        // State of the phase currently running, guarded by { lock }:
+        std::mutex              lock;
+        std::condition_variable work_done;
+        std::deque<int>         ready_main;
+        std::vector<Node>*      running_graph   = nullptr;
+        f64                     running_delta   = 0.0;
+        int                     completed_count = 0;
+
+        std::chrono::steady_clock::time_point phase_start;
+
+    public:
+        System_Scheduler()  = default;
+        ~System_Scheduler() = default;
+
+        System_Scheduler(const System_Scheduler&)            = delete;
+        System_Scheduler& operator=(const System_Scheduler&) = delete;
+
+        void
+        add_system(Base_System* system, const std::string& name);
+
+        /*
+            Run every system of the { phase } and wait for them to finish, must be called from the main thread.
+        */
+        void
+        run(System_Phase phase, f64 delta_time);
+
+        const std::vector<System_Timing>&
+        get_timings(System_Phase phase) const;
+
+        /*
+            Length of the longest chain of dependent systems in the last run of the { phase }, this is the
+            lower bound for the phase no matter how many threads are available.
+        */
+        f64
+        get_critical_path_ms(System_Phase phase) const;
+
+    private:
+        /*
+            Run the system and release its dependents.
+        */
+        void
+        execute(int node_index);
+
+        /*
+            Queue the system for the main thread, or add it to { ready_jobs }. Expects { lock } to be held.
+        */
+        void
+        push_ready(int node_index, std::vector<int>& ready_jobs);
+
+        /*
+            Run the systems as jobs on the { Job_System }, must be called without holding { lock }.
+        */
+        void
+        schedule(const std::vector<int>& ready_jobs);
+    };
+
+} // jbx
@@ -0,0 +1,138 @@
+
+#pragma once
+
+#include <ecs/Entity.hpp>
+#include <ecs/Component.hpp>
+#include <ecs/Pool.hpp>
+#include <ecs/Archetype.hpp>
+
+// Dependencies (3rd party):
+#include <tuple>
+#include <type_traits>
+
+namespace jbx {
+
+#if PROJECT_ECS_STORAGE_ARCHETYPES
+    /*
+        With archetype storage views iterate chunks directly, see { Archetype_View }.
+    */
+    template <typename ...Ts>
+    using View = Archetype_View<Ts...>;
+#else
+    /*
+        { View } iterates over every entity which has all of the components { Ts... }, created with
+        { Registry::view<Ts...>() }.
+
+        Pools are resolved once when the view is created, iteration is driven by the smallest pool and
+        every candidate is filtered with a single { Component_Mask } check, so the cost is proportional to
+        the size of the smallest pool.
+
+        Usage:
+            registry->view<Rect, const Velocity>().each([](Entity entity, Rect& rect, const Velocity& velocity) {
+                ...
+            });
+
+        Components listed as { const T } are read through the const pool and are not marked as changed, the
+        others are, see { each }.
+
+        Components must not be added to or removed from the driving pool while iterating.
+    */
+    template <typename ...Ts>
+    class View final {
+    private:
+        // Pool of a component type, const for the types the view only reads:
+        template <typename T>
+        using View_Pool = std::conditional_t<std::is_const_v<T>, const Pool<std::remove_const_t<T>>, Pool<T>>;
+
+        std::tuple<View_Pool<Ts>*...>      pools;
+        const std::vector<Component_Mask>& component_masks;
+        const std::vector<Entity>&         entity_slots;
+        Component_Mask                     mask;
+
+    public:
+        View(
+            View_Pool<Ts>* ...pools,
+            const std::vector<Component_Mask>& component_masks,
+            const std::vector<Entity>& entity_slots
+        );
+
+        /*
+            Call { fn(Entity, Ts&...) } for every entity in the view, marks the components which are not
+            { const } as changed.
+        */
+        template <typename T_Fn>
+        void
+        each(T_Fn&& fn);
+
+        /*
+            Number of entities the view will visit at most, which is the size of the smallest pool.
+        */
+        int
+        size_hint() const;
+
+    private:
+        const Base_Pool*
+        get_driving_pool() const;
+    };
+
+    /*
+    ## View: template implementations
+    */
+
+    template <typename ...Ts>
+    View<Ts...>::View(
+        View_Pool<Ts>* ...pools,
+        const std::vector<Component_Mask>& component_masks,
+        const std::vector<Entity>& entity_slots
+    )
+    : pools(pools...), component_masks(component_masks), entity_slots(entity_slots) {
+        (mask.add<std::remove_const_t<Ts>>(), ...);
+    }
+
+    template <typename ...Ts>
+    const Base_Pool*
+    View<Ts...>::get_driving_pool() const {
+        const Base_Pool* smallest = nullptr;
+        bool any_missing          = false;
+
+        auto pick = [&](const Base_Pool* pool) {
+            if (pool == nullptr) {
+                any_missing = true;
+            } else if (smallest == nullptr || pool->get_count() < smallest->get_count()) {
+                smallest = pool;
+            }
+        };
+        std::apply([&](auto* ...pool) { (pick(pool), ...); }, pools);
+
+        // If any of the pools does not exist yet no entity can match:
+        return any_missing ? nullptr : smallest;
+    }
+
+    template <typename ...Ts>
+    int
+    View<Ts...>::size_hint() const {
+        const Base_Pool* driver = get_driving_pool();
+        return driver != nullptr ? driver->get_count() : 0;
+    }
+
+    template <typename ...Ts>
+    template <typename T_Fn>
+    void
+    View<Ts...>::each(T_Fn&& fn) {
+        const Base_Pool* driver = get_driving_pool();
+        if (driver == nullptr) {
+            return;
+        }
+
+        for (int index = 0; index < driver->get_count(); index++) {
+            const int entity_id = driver->get_entity_id(index);
+            if (!component_masks[entity_id].contains(mask)) {
+                continue;
+            }
+
+            std::apply([&](auto* ...pool) { fn(entity_slots[entity_id], pool->get(entity_id)...); }, pools);
+        }
+    }
+#endif // PROJECT_ECS_STORAGE_ARCHETYPES
+
+} // jbx
@@ -6,3 +6,5 @@
 */
 
 #include <ecs/Registry.hpp>
+#include <ecs/Snapshot.hpp>
+#include <ecs/Frame_History.hpp>
@@ -4,6 +4,7 @@
 
 // Dependencies:
 #include <engine/core/engine.hpp>
+#include <engine/core/engine_instance.hpp>
 
 // Dependencies (3rd_party):
 #include <windows.h>
@@ -53,9 +54,7 @@ namespace jbx {
     }
 
     static inline HWND
-    create_main_window(HINSTANCE hInstance, int nCmdShow) {
-        Unique<Engine_Config>& config = get_context<Engine_Config>();
-
+    create_main_window(const Engine_Config* config, HINSTANCE hInstance, int nCmdShow) {
         // Setup the window class:
         WNDCLASSEX window_class;
         window_class.cbSize         = sizeof(WNDCLASSEX);
@@ -98,11 +97,11 @@ namespace jbx {
     }
 
     void
-    initialize_and_start_backend() {
-        Unique<Engine_Config>&  config  = get_context<Engine_Config>();
+    initialize_and_start_backend(Engine_Instance& instance) {
+        Engine_Config*          config  = &instance.config;
         Unique<Engine_Context>& context = get_context<Engine_Context>();
 
-        context->window = create_main_window(config->instance, config->cmd_show);
+        context->window = create_main_window(config, config->instance, config->cmd_show);
 
         DXGI_SWAP_CHAIN_DESC sd               = {};
         sd.BufferCount                        = 1;
@@ -204,7 +203,7 @@ namespace jbx {
     }
 
     void
-    draw_texture(Texture& texture, const Rect& entity_rect) {
+    draw_texture(const Texture& texture, const Rect& entity_rect) {
         log_warn("{ draw_texture } not implemented!");
     }
 
@@ -4,8 +4,8 @@
 
 // Dependencies:
 #include <engine/core/engine.hpp>
-#include <engine/core/frontend_hook.hpp>
-#include <features/features.hpp>
+#include <engine/core/engine_instance.hpp>
+#include <engine/core/job_system.hpp>
 
 // Dependencies (3rd_party):
 // Workaround the Raylib name clashes with { windows.h }, does not work with Clang!
@@ -46,6 +46,7 @@ namespace jbx {
 
     /*
         Raylib backend context.
+        - { instance }: the engine instance which owns the window, assets are resolved with its config.
         - { should_run }: keeps the main loop running.
         - { clear_color }: platform window clear color.
         - { s32x2 }: platform window size.
@@ -58,6 +59,7 @@ namespace jbx {
     constexpr int MAX_FONT_COUNT    = 16;
 
     struct Engine_Context {
+        Engine_Instance*     instance;
         bool                 should_run;
         rl::Color            clear_color;
         s32x2                window_size;
@@ -70,7 +72,8 @@ namespace jbx {
         Array<rl::Image>     images;
 
         Engine_Context()
-        : clear_color({45, 45, 45, 255}),
+        : instance(nullptr),
+          clear_color({45, 45, 45, 255}),
           should_run(true),
           window_size({0, 0}),
           textures(MAX_TEXTURE_COUNT),
@@ -97,14 +100,14 @@ namespace jbx {
 
 
     static void
-    resource_thread_fn() {
+    load_resources_job() {
         Sleep(1024);
         Unique<Engine_Context>& context = get_context<Engine_Context>();
         // Adding tilemap just to test it all out, even though it will be loaded on it's own
         // later.
         for (const std::string& image_name: {"colormap", "Crt_UV"}) {
             // We just assume that only the resource thread will ever write to this array:
-            context->images.add(rl::LoadImage(image_path(image_name).c_str()));
+            context->images.add(rl::LoadImage(image_path(context->instance->config, image_name).c_str()));
         }
 
         context->images_loaded = true;
@@ -112,10 +115,11 @@ namespace jbx {
 
 
     void
-    initialize_and_start_backend() {
-        Unique<Engine_Config>&  config   = get_context<Engine_Config>();
+    initialize_and_start_backend(Engine_Instance& instance) {
+        Engine_Config*          config   = &instance.config;
+        Registry*               registry = &instance.registry;
         Unique<Engine_Context>& context  = get_context<Engine_Context>();
-        Unique<Registry>&       registry = get_context<Registry>();
+        context->instance = &instance;
 
         // Raylib should only log errors:
         rl::SetTraceLogLevel(rl::LOG_ERROR);
@@ -196,21 +200,21 @@ namespace jbx {
         camera.fovy         = 45.0f;
         camera.projection   = rl::CAMERA_PERSPECTIVE;
 
-        std::thread resource_thread(resource_thread_fn);
-        resource_thread.detach();
+        // This blocks one of the workers for a while, which is fine as long as we only do it once:
+        get_context<Job_System>()->run([] { load_resources_job(); });
 
         rl::Model plane = rl::LoadModelFromMesh(rl::GenMeshPlane(8.0f, 6.0f, 1, 1));
         plane.materials[0].maps[rl::MATERIAL_MAP_DIFFUSE].texture = model_texture.texture;
 
-        rl::Model donut = rl::LoadModel(model_path_glb("donut-sprinkles").c_str());
-        rl::Model crt_monitor = rl::LoadModel(model_path_glb("crt2").c_str());
+        rl::Model donut = rl::LoadModel(model_path_glb(*config, "donut-sprinkles").c_str());
+        rl::Model crt_monitor = rl::LoadModel(model_path_glb(*config, "crt2").c_str());
 
         // Main loop:
         const f64 S_PER_FRAME = 1.0/config->desired_framerate;
         f64 last_elapsed_s    = rl::GetTime();
 
         // Run user code to init/start the game:
-        frontend_start();
+        instance.start();
         rl::DisableCursor();
 
         float x = 0.0f, y = 0.0f, z = 0.0f;
@@ -227,10 +231,15 @@ namespace jbx {
             f64 delta_s           = current_elapsed_s - last_elapsed_s;
             last_elapsed_s        = current_elapsed_s;
 
-            // Run user frame code:
-            registry->update();
-            frontend_step(delta_s);
-            registry->get_system<Basic_Velocity_System>().update(delta_s);
+            // Keys pressed since the last frame, read by the next tick. Only keys of { Keyboard_Key } are sent:
+            for (int key = rl::GetKeyPressed(); key != 0; key = rl::GetKeyPressed()) {
+                if (key >= KEY_A && key <= KEY_Z) {
+                    instance.registry.get_events().send(Key_Event { static_cast<Keyboard_Key>(key) });
+                }
+            }
+
+            // Run the simulation ticks which fit into this frame, the renderers interpolate between the last two:
+            instance.advance(delta_s);
 
             if (rl::IsKeyPressed(rl::KEY_SPACE)) {
                 x += 0.1f;
@@ -266,9 +275,8 @@ namespace jbx {
             {
                 rl::BeginTextureMode(frame_texture); {
                     rl::ClearBackground({0,0,0,0});
-                    registry->get_system<Rect_Renderer_System>().update(delta_s);
-                    registry->get_system<Texture_Renderer_System>().update(delta_s);
-                    registry->get_system<Text_Renderer_System>().update(delta_s);
+                    // Renderers are pinned to the main thread, and run in the order they were added:
+                    registry->run_systems(System_Phase_Render, delta_s);
                 } rl::EndTextureMode();
 
                 // Apply post-processing:
@@ -299,7 +307,8 @@ namespace jbx {
         }
 
         // Run user exit code:
-        frontend_stop();
+        instance.stop();
+        context->instance = nullptr;
 
         rl::CloseAudioDevice();
         rl::CloseWindow();
@@ -334,7 +343,7 @@ namespace jbx {
     load_texture(const std::string& texture_file_name) {
         Unique<Engine_Context>& context = get_context<Engine_Context>();
 
-        std::string path = image_path(texture_file_name);
+        std::string path = image_path(context->instance->config, texture_file_name);
         log_warn("Loading texture: {}", path);
 
         rl::Texture2D texture = rl::LoadTexture(path.c_str());
@@ -347,20 +356,21 @@ namespace jbx {
     }
 
     void
-    draw_texture(Texture& texture, const Rect& entity_rect) {
+    draw_texture(const Texture& texture, const Rect& entity_rect) {
         Unique<Engine_Context>& context     = get_context<Engine_Context>();
         const rl::Texture2D& source_texture = context->textures[texture.id];
 
-        // @todo: we can probably do this somewhere else...
         // If any of the given textures dimensions are 0, inherit dimensions of the source texture.
-        if (texture.rect.z == 0.0f || texture.rect.w == 0.0f) {
-            texture.rect.z = source_texture.width;
-            texture.rect.w = source_texture.height;
+        // The component is left as is, drawing must not mark it as changed:
+        f32x4 source_rect = texture.rect;
+        if (source_rect.z == 0.0f || source_rect.w == 0.0f) {
+            source_rect.z = source_texture.width;
+            source_rect.w = source_texture.height;
         }
 
         rl::DrawTexturePro(
             source_texture,
-            rl::to_rectangle(texture.rect),
+            rl::to_rectangle(source_rect),
             rl::to_rectangle(entity_rect),
             { 0, 0 },
             0,
@@ -372,7 +382,7 @@ namespace jbx {
     load_sound(const std::string& sound_file_name, f32 volume, f32 pitch) {
         Unique<Engine_Context>& context = get_context<Engine_Context>();
 
-        std::string path = sound_path(sound_file_name);
+        std::string path = sound_path(context->instance->config, sound_file_name);
 
         rl::Sound sound = rl::LoadSound(path.c_str());
         int sound_id = context->sounds.get_count();
@@ -401,7 +411,7 @@ namespace jbx {
     load_font(const std::string& font_file_name, int font_size) {
         Unique<Engine_Context>& context = get_context<Engine_Context>();
 
-        std::string font_file_path = font_path(font_file_name);
+        std::string font_file_path = font_path(context->instance->config, font_file_name);
         log_warn("Loading font: {} with size: {}", font_file_path, font_size);
 
         rl::Font source_font = rl::LoadFontEx(font_file_path.c_str(), font_size, nullptr, 0);
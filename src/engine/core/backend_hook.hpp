@@ -4,7 +4,13 @@
 */
 namespace jbx {
 
+    struct Engine_Instance;
+
+    /*
+        Create the platform window for the { instance } and run it until the window is closed. There is only
+        one window per process, so there is only ever one instance with a backend.
+    */
     void
-    initialize_and_start_backend();
+    initialize_and_start_backend(Engine_Instance& instance);
 
 } // jbx
@@ -4,8 +4,8 @@
 
 // Dependencies:
 #include <engine/core/backend_hook.hpp>
-#include <ecs/ecs.hpp>
-#include <features/features.hpp>
+#include <engine/core/engine_instance.hpp>
+#include <engine/core/job_system.hpp>
 
 // Dependencies (3rd party):
 #include <filesystem>
@@ -16,14 +16,11 @@ namespace jbx {
     /*
         Validate the configuration, if invalid fall back to reasonable defaults.
     */
-    void
-    initialize_and_start(Engine_Config config) {
-        auto& validated_config = get_context<Engine_Config>();
-        *validated_config = config;
-
+    Engine_Config
+    validate_config(Engine_Config config) {
         if (config.window_title.empty()) {
             log_warn("Empty string provided for window_title\n* Falling back to: \"{}\"", PROJECT_INFO_STRING);
-            validated_config->window_title = PROJECT_INFO_STRING;
+            config.window_title = PROJECT_INFO_STRING;
         }
 
         if (config.window_width <= 0 || config.window_height <= 0) {
@@ -32,8 +29,8 @@ namespace jbx {
                 config.window_width, config.window_height
             );
 
-            validated_config->window_width = 800;
-            validated_config->window_height = 600;
+            config.window_width = 800;
+            config.window_height = 600;
         }
 
         if (config.desired_framerate <= 0) {
@@ -42,7 +39,34 @@ namespace jbx {
                 config.desired_framerate
             );
 
-            validated_config->desired_framerate = 60;
+            config.desired_framerate = 60;
+        }
+
+        if (config.simulation_rate <= 0) {
+            log_warn(
+                "Invalid config value passed: simulation_rate= {}\n* Falling back to: 60",
+                config.simulation_rate
+            );
+
+            config.simulation_rate = 60;
+        }
+
+        if (config.max_ticks_per_frame <= 0) {
+            log_warn(
+                "Invalid config value passed: max_ticks_per_frame= {}\n* Falling back to: 5",
+                config.max_ticks_per_frame
+            );
+
+            config.max_ticks_per_frame = 5;
+        }
+
+        if (config.pool_order_steps < 0) {
+            log_warn(
+                "Invalid config value passed: pool_order_steps= {}\n* Falling back to: 4096",
+                config.pool_order_steps
+            );
+
+            config.pool_order_steps = 4096;
         }
 
         if (config.root_dir.size() == 0) {
@@ -50,44 +74,51 @@ namespace jbx {
             log_warn("Empty config value passed for: root_dir\n* Falling back to: \"{}\"", config.root_dir);
         }
 
+        return config;
+    }
+
+    void
+    initialize_and_start(Engine_Config config) {
         /*
-            Add every system to registry.
+            The job system must be created from the main thread, before anything else uses it.
         */
-        Unique<Registry>& registry = get_context<Registry>();
-        registry->add_system<Basic_Velocity_System>();
-        registry->add_system<Rect_Renderer_System>();
-        registry->add_system<Texture_Renderer_System>();
-        registry->add_system<Text_Renderer_System>();
+        get_context<Job_System>();
 
-        initialize_and_start_backend();
+        Engine_Instance instance(config);
+        initialize_and_start_backend(instance);
     }
 
     /*
         Resources intentionally only support 1 extension, in order to simplify and reduce scope further...
     */
     std::string
-    image_path(const std::string& file_name) {
-        return get_context<Engine_Config>()->root_dir + "assets/images/" + file_name + ".png";
+    image_path(const Engine_Config& config, const std::string& file_name) {
+        return config.root_dir + "assets/images/" + file_name + ".png";
+    }
+
+    std::string
+    sound_path(const Engine_Config& config, const std::string& file_name) {
+        return config.root_dir + "assets/sounds/" + file_name + ".wav";
     }
 
     std::string
-    sound_path(const std::string& file_name) {
-        return get_context<Engine_Config>()->root_dir + "assets/sounds/" + file_name + ".wav";
+    font_path(const Engine_Config& config, const std::string& file_name) {
+        return config.root_dir + "assets/fonts/" + file_name + ".ttf";
     }
 
     std::string
-    font_path(const std::string& file_name) {
-        return get_context<Engine_Config>()->root_dir + "assets/fonts/" + file_name + ".ttf";
+    model_path(const Engine_Config& config, const std::string& file_name) {
+        return config.root_dir + "assets/models/" + file_name + ".obj";
     }
 
     std::string
-    model_path(const std::string& file_name) {
-        return get_context<Engine_Config>()->root_dir + "assets/models/" + file_name + ".obj";
+    model_path_glb(const Engine_Config& config, const std::string& file_name) {
+        return config.root_dir + "assets/models_glb/" + file_name + ".glb";
     }
 
     std::string
-    model_path_glb(const std::string& file_name) {
-        return get_context<Engine_Config>()->root_dir + "assets/models_glb/" + file_name + ".glb";
+    snapshot_path(const Engine_Config& config, const std::string& file_name) {
+        return config.root_dir + "assets/snapshots/" + file_name + ".snapshot";
     }
 
 } // jbx
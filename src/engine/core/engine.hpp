@@ -1,6 +1,11 @@
 
 #pragma once
 //@temporary
+
+// Dependencies:
+#include <ecs/Component.hpp>
+#include <ecs/Entity.hpp>
+
 namespace jbx {
 
     /*
@@ -9,29 +14,57 @@ namespace jbx {
         - { Window_Flags_Vsync }:      Enable VSYNC on the platform window.
         - { Window_Flags_Fullscreen }: Set the platform window video mode to fullscreen.
         - { Window_Flags_Borderless }: Remove all decorations from the platform window.
+        - { Engine_Flags_Headless }:   No window, the frontend gets stubs instead of the backend API. Used for
+                                       simulations which run without a backend, see { run_batch }.
     */
     typedef u8 Engine_Flags;
     enum Engine_Flags_ : u8 {
         Engine_Flags_None          = 0,        // 0000 0000
         Engine_Flags_Vsync         = 1 << 0,   // 0000 0001
         Engine_Flags_Fullscreen    = 1 << 1,   // 0000 0010
-        Engine_Flags_No_Decoration = 1 << 2    // 0000 0100
+        Engine_Flags_No_Decoration = 1 << 2,   // 0000 0100
+        Engine_Flags_Headless      = 1 << 3    // 0000 1000
+    };
+
+    /*
+        Order in which the components of every pool are kept, see { Registry::set_pool_order }:
+        - { Pool_Order_None }:       Components stay where adding and removing puts them.
+        - { Pool_Order_Entity_Id }:  By entity id, so the pools of every system line up.
+        - { Pool_Order_Spatial }:    By the Morton code of the { Rect } position, entities which are close on
+                                     screen are close in memory, for spatial queries and collisions.
+        - { Pool_Order_Render_Key }: By { Texture } id, entities which draw the same texture are drawn one
+                                     after the other.
+    */
+    enum Pool_Order : u8 {
+        Pool_Order_None = 0,
+        Pool_Order_Entity_Id,
+        Pool_Order_Spatial,
+        Pool_Order_Render_Key
     };
 
     /*
         Configure the engine, when unspecified or invalid the configuration will fall back to the following:
-        - { window_title }:      PROJECT_INFO_STRING, i.e: CV v0.2.0 (Debug)
-        - { window_width }:      800
-        - { window_height }:     600
-        - { desired_framerate }: 60
+        - { window_title }:        PROJECT_INFO_STRING, i.e: CV v0.2.0 (Debug)
+        - { window_width }:        800
+        - { window_height }:       600
+        - { desired_framerate }:   60, frames drawn per second.
+        - { simulation_rate }:     60, simulation ticks per second, independent of the framerate.
+        - { max_ticks_per_frame }: 5, ticks a single frame may catch up on. After a slow frame the
+                                   simulation falls behind instead of making every next frame slower.
+        - { pool_order }:          { Pool_Order_Entity_Id }, order of the component pools.
+        - { pool_order_steps }:    4096, entities worked on per tick at most to keep the { pool_order }.
     */
     struct Engine_Config {
-        std::string   root_dir          = "";
-        std::string   window_title      = PROJECT_INFO_STRING;
-        s16           window_width      = 800;
-        s16           window_height     = 600;
-        s16           desired_framerate = 60;
-        Engine_Flags  flags             = Engine_Flags_None;
+        std::string   root_dir            = "";
+        std::string   window_title        = PROJECT_INFO_STRING;
+        s16           window_width        = 800;
+        s16           window_height       = 600;
+        s16           desired_framerate   = 60;
+        s16           simulation_rate     = 60;
+        s16           max_ticks_per_frame = 5;
+        Pool_Order    pool_order          = Pool_Order_Entity_Id;
+        s32           pool_order_steps    = 4096;
+        Engine_Flags  flags               = Engine_Flags_None;
 
     #if PROJECT_ENGINE_BACKEND_DIRECTX
         HINSTANCE       instance;
@@ -39,6 +72,12 @@ namespace jbx {
     #endif
     };
 
+    /*
+        Returns a copy of the { config } where every invalid value is replaced with its fallback.
+    */
+    Engine_Config
+    validate_config(Engine_Config config);
+
     /*
         Validates engine configuration and initializes the specific engine backend.
         If correctly initialized the engine will start.
@@ -123,9 +162,39 @@ namespace jbx {
         Color       color;
 
         Text(std::string data = "", Font font = {}, Color color = {255,255,255,255})
-        : data(data), font(font), color(color) {}
+        : data(std::move(data)), font(font), color(color) {}
     };
 
+    /*
+        Makes the entity a child of { entity }, its { Rect } then follows the parent: it's derived from the
+        { Local_Rect } by the { Hierarchy_System }.
+    */
+    struct Parent {
+        Entity entity;
+
+        Parent(Entity entity = Entity(-1))
+        : entity(entity) {}
+    };
+
+    /*
+        Rect of a child relative to its { Parent }: x and y are offsets from the position of the parent rect,
+        width and height are the child's own.
+    */
+    struct Local_Rect : f32x4 {
+        using f32x4::f32x4;
+    };
+
+    /*
+        Component ids, see { REGISTER_COMPONENT }. These end up in saved data, add new ones at the end.
+    */
+    REGISTER_COMPONENT(Rect,       0);
+    REGISTER_COMPONENT(Color,      1);
+    REGISTER_COMPONENT(Velocity,   2);
+    REGISTER_COMPONENT(Texture,    3);
+    REGISTER_COMPONENT(Text,       4);
+    REGISTER_COMPONENT(Parent,     5);
+    REGISTER_COMPONENT(Local_Rect, 6);
+
 
     // Keys:
     enum Keyboard_Key {
@@ -159,6 +228,13 @@ namespace jbx {
         KEY_Z  = 90
     };
 
+    /*
+        Sent by the backend for every key pressed since the last frame, see { Event_Bus }.
+    */
+    struct Key_Event {
+        Keyboard_Key key;
+    };
+
     bool
     is_key_pressed(Keyboard_Key key);
 
@@ -172,7 +248,7 @@ namespace jbx {
     load_texture(const std::string& texture_file_name);
 
     void
-    draw_texture(Texture& texture, const Rect& entity_rect);
+    draw_texture(const Texture& texture, const Rect& entity_rect);
 
     Sound
     load_sound(const std::string& sound_file_name, f32 volume, f32 pitch);
@@ -189,23 +265,27 @@ namespace jbx {
     /*
     ## Common
 
-        Set of common engine functions, implemented in { 2d_engine.cpp }.
+        Set of common engine functions, implemented in { engine.cpp }. Assets are resolved relative to the
+        { root_dir } of the given { config }.
     */
 
     std::string
-    image_path(const std::string& file_name);
+    image_path(const Engine_Config& config, const std::string& file_name);
+
+    std::string
+    sound_path(const Engine_Config& config, const std::string& file_name);
 
     std::string
-    sound_path(const std::string& file_name);
+    font_path(const Engine_Config& config, const std::string& file_name);
 
     std::string
-    font_path(const std::string& file_name);
+    model_path(const Engine_Config& config, const std::string& file_name);
 
     std::string
-    model_path(const std::string& file_name);
+    model_path_glb(const Engine_Config& config, const std::string& file_name);
 
     std::string
-    model_path_glb(const std::string& file_name);
+    snapshot_path(const Engine_Config& config, const std::string& file_name);
 
 
 } // jbx
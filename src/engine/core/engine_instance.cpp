@@ -0,0 +1,219 @@
+
+// Implements:
+#include <engine/core/engine_instance.hpp>
+
+// Dependencies:
+#include <engine/core/job_system.hpp>
+#include <features/features.hpp>
+
+// Dependencies (3rd party):
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace jbx {
+
+    /*
+        Spread the low 16 bits of { value } out to the even bits.
+    */
+    static u32
+    spread_bits(u32 value) {
+        value = (value | (value << 8)) & 0x00FF00FF;
+        value = (value | (value << 4)) & 0x0F0F0F0F;
+        value = (value | (value << 2)) & 0x33333333;
+        value = (value | (value << 1)) & 0x55555555;
+        return value;
+    }
+
+    /*
+        Keys of { Pool_Order_Entity_Id }, they come pre-filled with the entity id.
+    */
+    static void
+    get_entity_id_keys(Registry&, int, int, u64*) {
+    }
+
+    /*
+        Keys of { Pool_Order_Spatial }: the Morton code of the cell of the rect position in the high bits, cells
+        are 16 units wide and the code covers -512k..512k on both axes. Entities without a rect go first.
+    */
+    static void
+    get_spatial_keys(Registry& registry, int first_entity_id, int count, u64* keys) {
+        constexpr f32 CELL_SIZE = 16.0f;
+        constexpr f32 CELL_BIAS = 32768.0f;
+
+        const Component_Storage<Rect>& rects = registry.get_storage<Rect>();
+        for (int index = 0; index < count; index++) {
+            const int entity_id = first_entity_id + index;
+            if (!rects.contains(entity_id)) {
+                continue;
+            }
+
+            const Rect& rect = rects.get(entity_id);
+            const u32 cell_x = static_cast<u32>(std::clamp(rect.x / CELL_SIZE + CELL_BIAS, 0.0f, 65535.0f));
+            const u32 cell_y = static_cast<u32>(std::clamp(rect.y / CELL_SIZE + CELL_BIAS, 0.0f, 65535.0f));
+            const u32 code   = spread_bits(cell_x) | (spread_bits(cell_y) << 1);
+
+            keys[index] = (static_cast<u64>(code) << 32) | static_cast<u32>(entity_id);
+        }
+    }
+
+    /*
+        Keys of { Pool_Order_Render_Key }: the texture id in the high bits, entities without a texture go first.
+    */
+    static void
+    get_render_keys(Registry& registry, int first_entity_id, int count, u64* keys) {
+        const Component_Storage<Texture>& textures = registry.get_storage<Texture>();
+        for (int index = 0; index < count; index++) {
+            const int entity_id = first_entity_id + index;
+            if (!textures.contains(entity_id)) {
+                continue;
+            }
+
+            const Texture& texture = textures.get(entity_id);
+            keys[index]            = (static_cast<u64>(static_cast<u32>(texture.id) + 1) << 32) | static_cast<u32>(entity_id);
+        }
+    }
+
+    static Pool_Order_Fn
+    get_pool_order_fn(Pool_Order pool_order) {
+        switch (pool_order) {
+            case Pool_Order_Entity_Id:
+                return get_entity_id_keys;
+
+            case Pool_Order_Spatial:
+                return get_spatial_keys;
+
+            case Pool_Order_Render_Key:
+                return get_render_keys;
+
+            default:
+                return nullptr;
+        }
+    }
+
+    /*
+    ## Engine_Instance: implementation
+    */
+
+    Engine_Instance::Engine_Instance(const Engine_Config& config)
+    : config(validate_config(config)) {
+        registry.add_system<Interpolation_System>();
+        registry.add_system<Basic_Velocity_System>();
+        registry.add_system<Hierarchy_System>();
+        registry.add_system<Spatial_Index_System>();
+        registry.add_system<Collision_System>();
+        registry.add_system<Rect_Renderer_System>();
+        registry.add_system<Texture_Renderer_System>();
+        registry.add_system<Text_Renderer_System>();
+
+        // Events sent by the engine, read by the systems and the frontend:
+        registry.get_events().add_event_type<Key_Event>();
+        registry.get_events().add_event_type<Contact>();
+
+        registry.set_pool_order(get_pool_order_fn(this->config.pool_order), this->config.pool_order_steps);
+    }
+
+    void
+    Engine_Instance::start() {
+        frontend_start(*this);
+    }
+
+    void
+    Engine_Instance::step(f64 delta_time) {
+        registry.update();
+
+        // Before the user code, which may move entities too:
+        registry.get_system<Interpolation_System>().save_previous_rects();
+
+        frontend_step(*this, delta_time);
+        registry.run_systems(System_Phase_Update, delta_time);
+
+        tick_count += 1;
+    }
+
+    int
+    Engine_Instance::advance(f64 frame_time_s) {
+        const f64 tick_time = get_tick_time();
+        unsimulated_s      += std::max(frame_time_s, 0.0);
+
+        int ticks = 0;
+        while (unsimulated_s >= tick_time && ticks < config.max_ticks_per_frame) {
+            step(tick_time);
+            unsimulated_s -= tick_time;
+            ticks         += 1;
+        }
+
+        // Too far behind, give up on the time which could not be simulated:
+        if (unsimulated_s >= tick_time) {
+            unsimulated_s = std::fmod(unsimulated_s, tick_time);
+        }
+
+        registry.get_system<Interpolation_System>().set_alpha(static_cast<f32>(unsimulated_s / tick_time));
+        return ticks;
+    }
+
+    f64
+    Engine_Instance::get_tick_time() const {
+        return 1.0 / config.simulation_rate;
+    }
+
+    void
+    Engine_Instance::stop() {
+        frontend_stop(*this);
+        frontend = nullptr;
+    }
+
+    /*
+    ## Batch: implementation
+    */
+
+    Batch_Stats
+    run_batch(const Engine_Config& config, int instance_count, int ticks) {
+        ERROR_IF(instance_count <= 0, "Batch needs at least one instance!");
+
+        Engine_Config headless_config = config;
+        headless_config.flags        |= Engine_Flags_Headless;
+
+        Unique<Job_System>& job_system = get_context<Job_System>();
+        const int thread_count         = job_system->get_thread_count();
+        const int group_size           = (instance_count + thread_count - 1) / thread_count;
+
+        // Every instance has its own VM, so they can be created and started in parallel too:
+        std::vector<Unique<Engine_Instance>> instances(instance_count);
+        job_system->parallel_for(0, instance_count, group_size, [&](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                instances[i] = std::make_unique<Engine_Instance>(headless_config);
+                instances[i]->start();
+            }
+        });
+
+        const f64 delta_time   = instances[0]->get_tick_time();
+        const auto ticks_start = std::chrono::steady_clock::now();
+
+        job_system->parallel_for(0, instance_count, group_size, [&](int begin, int end) {
+            for (int tick = 0; tick < ticks; tick++) {
+                for (int i = begin; i < end; i++) {
+                    instances[i]->step(delta_time);
+                }
+            }
+        });
+
+        const auto ticks_end = std::chrono::steady_clock::now();
+
+        job_system->parallel_for(0, instance_count, group_size, [&](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                instances[i]->stop();
+                instances[i] = nullptr;
+            }
+        });
+
+        Batch_Stats stats      = {};
+        stats.instance_count   = instance_count;
+        stats.tick_count       = static_cast<u64>(instance_count) * static_cast<u64>(std::max(ticks, 0));
+        stats.duration_s       = std::chrono::duration<f64>(ticks_end - ticks_start).count();
+        stats.ticks_per_second = stats.duration_s > 0.0 ? stats.tick_count / stats.duration_s : 0.0;
+
+        return stats;
+    }
+
+} // jbx
@@ -0,0 +1,105 @@
+
+#pragma once
+
+// Dependencies:
+#include <engine/core/engine.hpp>
+#include <engine/core/frontend_hook.hpp>
+#include <ecs/ecs.hpp>
+
+namespace jbx {
+
+    /*
+        { Engine_Instance } is a single running game: its configuration, the { Registry } with every entity and
+        system, and the frontend state (the Lua VM). Instances share nothing but the { Job_System } and the
+        logger, so a process may run many of them at once, see { run_batch }.
+
+        Systems get the { Registry } they belong to and frontend bindings capture their instance, nothing
+        reaches the instance through { get_context }. An instance is only ever stepped by one thread at a
+        time, which one does not matter.
+
+        Usage:
+            Engine_Instance instance(config);
+            instance.start();
+            while (running) {
+                instance.advance(frame_time_s);
+                ... // render
+            }
+            instance.stop();
+    */
+    struct Engine_Instance {
+        Engine_Config            config;
+        Registry                 registry;
+        Shared<Frontend_Context> frontend;
+        u64                      tick_count = 0;
+
+        // Frame time which was not simulated yet, always less than a tick after { advance }:
+        f64                      unsimulated_s = 0.0;
+
+        /*
+            The { config } is validated, every engine system is added to the registry.
+        */
+        explicit Engine_Instance(const Engine_Config& config);
+        ~Engine_Instance() = default;
+
+        Engine_Instance(const Engine_Instance&)            = delete;
+        Engine_Instance& operator=(const Engine_Instance&) = delete;
+
+        /*
+            Start the frontend, runs the user { begin } code.
+        */
+        void
+        start();
+
+        /*
+            Simulate a single tick: apply structural changes, run the user { step } code and the update
+            systems. Rendering is up to the backend, see { System_Phase_Render }.
+        */
+        void
+        step(f64 delta_time);
+
+        /*
+            Run as many ticks of 1 / { simulation_rate } as fit into the time passed since the last frame,
+            the rest carries over to the next frame. Sets the interpolation alpha of the renderers to where the
+            frame is in between the last two ticks, see { Interpolation_System }. Returns the number of ticks.
+
+            At most { max_ticks_per_frame } ticks are run, the time beyond them is dropped and the game slows
+            down instead of every frame taking longer than the one before.
+        */
+        int
+        advance(f64 frame_time_s);
+
+        /*
+            Time step of a single tick, 1 / { simulation_rate }.
+        */
+        f64
+        get_tick_time() const;
+
+        /*
+            Run the user { end } code and release the frontend.
+        */
+        void
+        stop();
+    };
+
+    /*
+        Result of { run_batch }, { tick_count } is the sum over every instance.
+    */
+    struct Batch_Stats {
+        int  instance_count;
+        u64  tick_count;
+        f64  duration_s;
+        f64  ticks_per_second;
+    };
+
+    /*
+        Run { instance_count } headless instances of the same game for { ticks } ticks each, with a fixed
+        time step of 1 / { simulation_rate }. Used for automated play testing and balancing.
+
+        Instances are split into one contiguous group per { Job_System } thread, every group is stepped by a
+        single job in lock step. Systems of an instance still split their work into batches, which idle
+        threads steal. Only the ticks are timed, starting and stopping the instances is not.
+    */
+    Batch_Stats
+    run_batch(const Engine_Config& config, int instance_count, int ticks);
+
+} // jbx
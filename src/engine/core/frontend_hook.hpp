@@ -1,27 +1,38 @@
 #pragma once
 /*
     Every frontend must implement the following hooks.
+
+    Frontend state (e.g. the VM) belongs to the { Engine_Instance } it was started for, see { Frontend_Context },
+    so every instance runs its own copy of the user code.
 */
 namespace jbx {
 
+    struct Engine_Instance;
+
+    /*
+        Frontend specific state, only defined by the frontend. { Engine_Instance } keeps it in a { Shared }
+        pointer, so it can be destroyed without the definition.
+    */
+    struct Frontend_Context;
+
     /*
         Setup the virtual machine for a given backend and run the user code to initialize their game.
         @todo: should we separate frontend setup - i.e: starting the VM from user lifecycle "start" call?
     */
     void
-    frontend_start();
+    frontend_start(Engine_Instance& instance);
 
     /*
         Run user code for every single frame.
     */
     void
-    frontend_step(f64 delta_time);
+    frontend_step(Engine_Instance& instance, f64 delta_time);
 
     /*
         Run user cleanup code and shut the VM down, or cleanup, ...
     */
     void
-    frontend_stop();
+    frontend_stop(Engine_Instance& instance);
 
     void
     tester();
@@ -0,0 +1,272 @@
+
+// Implements:
+#include <engine/core/job_system.hpp>
+
+namespace jbx {
+
+    /*
+        Index of the calling thread in the pool, see { Job_System::get_thread_index }.
+    */
+    static thread_local int current_thread_index = -1;
+
+    /*
+    ## Job_Deque: implementation
+
+        The index updates which race with other threads are sequentially consistent instead of using the
+        standalone fences of the original paper, on x86 it costs the same and sanitizers understand it.
+    */
+
+    bool
+    Job_Deque::push(Job_Slot* slot) {
+        const s64 b = bottom.load(std::memory_order_relaxed);
+        const s64 t = top.load(std::memory_order_acquire);
+        if (b - t >= CAPACITY) {
+            return false;
+        }
+
+        // Publish the slot (and the job in it) to the thieves:
+        buffer[b & (CAPACITY - 1)].store(slot, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    Job_Slot*
+    Job_Deque::pop() {
+        // Reserve the bottom job before looking at the top, so a thief can't take it at the same time:
+        const s64 b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_seq_cst);
+        s64 t = top.load(std::memory_order_seq_cst);
+
+        // Empty, restore the bottom:
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_release);
+            return nullptr;
+        }
+
+        Job_Slot* slot = buffer[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+
+        // Last job, race the thieves for it:
+        if (t == b) {
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                slot = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_release);
+        }
+
+        return slot;
+    }
+
+    Job_Slot*
+    Job_Deque::steal() {
+        s64 t = top.load(std::memory_order_seq_cst);
+        const s64 b = bottom.load(std::memory_order_seq_cst);
+
+        if (t >= b) {
+            return nullptr;
+        }
+
+        Job_Slot* slot = buffer[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+
+        return slot;
+    }
+
+    /*
+    ## Job_System: implementation
+    */
+
+    Job_System::Job_System(int worker_count) {
+        if (worker_count < 0) {
+            worker_count = std::max(0, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+        }
+
+        // The thread which creates the pool is the main thread:
+        current_thread_index = 0;
+
+        for (int thread_index = 0; thread_index <= worker_count; thread_index++) {
+            workers.push_back(std::make_unique<Worker>());
+            workers.back()->steal_seed = 0x9E3779B9u * (thread_index + 1);
+        }
+
+        for (int thread_index = 1; thread_index <= worker_count; thread_index++) {
+            threads.emplace_back(&Job_System::worker_fn, this, thread_index);
+        }
+    }
+
+    Job_System::~Job_System() {
+        stopping = true;
+        {
+            std::lock_guard<std::mutex> guard(sleep_lock);
+        }
+        wake_up.notify_all();
+
+        for (std::thread& thread: threads) {
+            thread.join();
+        }
+    }
+
+    void
+    Job_System::submit(const Job& job) {
+        const int thread_index = current_thread_index;
+
+        if (thread_index < 0) {
+            std::lock_guard<std::mutex> guard(injection_lock);
+            injection_queue.push_back(job);
+        } else {
+            Worker& worker = *workers[thread_index];
+            Job_Slot& slot = allocate_slot(worker);
+            slot.job       = job;
+
+            // The deque is full, nobody is keeping up so just do it now:
+            if (!worker.deque.push(&slot)) {
+                take_and_execute(slot);
+                return;
+            }
+        }
+
+        queued_jobs.fetch_add(1);
+
+        // Only touch the lock if someone might be sleeping, see { worker_fn }:
+        if (sleeping.load() > 0) {
+            {
+                std::lock_guard<std::mutex> guard(sleep_lock);
+            }
+            wake_up.notify_one();
+        }
+    }
+
+    Job_Slot&
+    Job_System::allocate_slot(Worker& worker) {
+        // Slots are released by whoever takes the job, skip the ones which were not taken yet:
+        while (true) {
+            Job_Slot& slot = worker.slots[worker.next_slot % SLOT_COUNT];
+            worker.next_slot += 1;
+
+            if (!slot.in_use.load(std::memory_order_acquire)) {
+                slot.in_use.store(true, std::memory_order_relaxed);
+                return slot;
+            }
+        }
+    }
+
+    Job_Slot*
+    Job_System::find_job(int thread_index) {
+        // Own deque first, it's the most recent work and likely still in cache:
+        if (thread_index >= 0) {
+            if (Job_Slot* slot = workers[thread_index]->deque.pop()) {
+                return slot;
+            }
+        }
+
+        // Then try to steal, starting from a random victim so the thieves spread out:
+        const int worker_count = static_cast<int>(workers.size());
+        u32 seed               = thread_index >= 0 ? workers[thread_index]->steal_seed : 0;
+        seed                   = seed * 1664525u + 1013904223u;
+        if (thread_index >= 0) {
+            workers[thread_index]->steal_seed = seed;
+        }
+
+        for (int i = 0; i < worker_count; i++) {
+            const int victim = static_cast<int>((seed + i) % worker_count);
+            if (victim == thread_index) {
+                continue;
+            }
+
+            if (Job_Slot* slot = workers[victim]->deque.steal()) {
+                return slot;
+            }
+        }
+
+        return nullptr;
+    }
+
+    void
+    Job_System::take_and_execute(Job_Slot& slot) {
+        Job job = slot.job;
+        slot.in_use.store(false, std::memory_order_release);
+
+        execute(job);
+    }
+
+    void
+    Job_System::execute(Job& job) {
+        Job_Counter* counter = job.counter;
+        job.function(job);
+
+        if (counter != nullptr) {
+            counter->value.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    bool
+    Job_System::execute_one() {
+        const int thread_index = current_thread_index;
+
+        if (Job_Slot* slot = find_job(thread_index)) {
+            queued_jobs.fetch_sub(1);
+            take_and_execute(*slot);
+            return true;
+        }
+
+        // Jobs from threads outside the pool, copied out since the queue may grow while it runs:
+        Job injected;
+        {
+            std::lock_guard<std::mutex> guard(injection_lock);
+            if (injection_queue.empty()) {
+                return false;
+            }
+
+            injected = injection_queue.front();
+            injection_queue.pop_front();
+        }
+
+        queued_jobs.fetch_sub(1);
+        execute(injected);
+        return true;
+    }
+
+    void
+    Job_System::wait(const Job_Counter& counter) {
+        while (counter.value.load(std::memory_order_acquire) > 0) {
+            if (!execute_one()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void
+    Job_System::worker_fn(int thread_index) {
+        current_thread_index = thread_index;
+
+        while (!stopping) {
+            if (execute_one()) {
+                continue;
+            }
+
+            /*
+                Nothing to do, go to sleep. { sleeping } is raised before { queued_jobs } is checked and
+                { submit } raises { queued_jobs } before it checks { sleeping }, so a wake up is never lost.
+            */
+            sleeping.fetch_add(1);
+            {
+                std::unique_lock<std::mutex> held_lock(sleep_lock);
+                wake_up.wait(held_lock, [this] { return stopping || queued_jobs.load() > 0; });
+            }
+            sleeping.fetch_sub(1);
+        }
+    }
+
+    int
+    Job_System::get_thread_count() const {
+        return static_cast<int>(workers.size());
+    }
+
+    int
+    Job_System::get_thread_index() const {
+        return current_thread_index;
+    }
+
+} // jbx
@@ -0,0 +1,248 @@
+
+#pragma once
+
+// Dependencies (3rd party):
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <type_traits>
+#include <algorithm>
+
+namespace jbx {
+
+    /*
+        Counts the unfinished jobs it was given to, see { Job_System::wait }.
+    */
+    struct Job_Counter {
+        std::atomic<int> value = 0;
+    };
+
+    /*
+        A unit of work, the closure is stored inline so scheduling a job never allocates.
+    */
+    constexpr int JOB_DATA_SIZE = 48;
+
+    struct alignas(64) Job {
+        void        (*function)(Job& job);
+        Job_Counter*  counter;
+        alignas(16) u8 data[JOB_DATA_SIZE];
+    };
+
+    /*
+        Jobs are queued in slots owned by the thread which scheduled them, whoever takes the job out of the
+        queue copies it and releases the slot before running it.
+    */
+    struct Job_Slot {
+        Job               job;
+        std::atomic<bool> in_use = false;
+    };
+
+    /*
+        Fixed size Chase-Lev work stealing deque, the owner pushes and pops from the bottom, other threads
+        steal from the top. No locks, the only contended operation is a CAS on { top } for the last job.
+    */
+    class Job_Deque final {
+    public:
+        static constexpr s64 CAPACITY = 4096;
+
+    private:
+        static_assert((CAPACITY & (CAPACITY - 1)) == 0, "Job_Deque capacity must be a power of 2!");
+
+        alignas(64) std::atomic<s64> top    = 0;
+        alignas(64) std::atomic<s64> bottom = 0;
+        std::atomic<Job_Slot*>       buffer[CAPACITY];
+
+    public:
+        /*
+            Owner only, returns false if the deque is full.
+        */
+        bool
+        push(Job_Slot* slot);
+
+        /*
+            Owner only, returns { nullptr } if the deque is empty.
+        */
+        Job_Slot*
+        pop();
+
+        /*
+            Any thread, returns { nullptr } if the deque is empty or another thread won the race.
+        */
+        Job_Slot*
+        steal();
+    };
+
+    /*
+        { Job_System } is the engine thread pool, reach it with { get_context<Job_System>() } and create it from
+        the main thread before any other thread uses it.
+
+        Every worker owns a { Job_Deque }, jobs it schedules go to its own deque and idle workers steal from
+        the others. The main thread owns deque 0 and only executes jobs while it waits, threads which are not
+        part of the pool (e.g. spdlog's) submit through a locked injection queue.
+
+        Dependencies are expressed with { Job_Counter }s, { wait } executes other jobs until the counter drops
+        to zero, so waiting from inside a job never blocks a worker.
+
+        Usage:
+            Job_Counter counter;
+            job_system->run([&]{ decode_image(...); }, &counter);
+            job_system->parallel_for(0, count, 1024, [&](int begin, int end) { ... });
+            job_system->wait(counter);
+
+        Closures must be trivially copyable and at most { JOB_DATA_SIZE } bytes, capture by reference.
+    */
+    class Job_System final {
+    private:
+        /*
+            Per thread state, { slots } is a ring the owner allocates from. It's twice the size of the deque,
+            so there is always a free slot close by: at most a full deque plus one slot per thread is in use.
+        */
+        static constexpr int SLOT_COUNT = static_cast<int>(Job_Deque::CAPACITY) * 2;
+
+        struct Worker {
+            Job_Deque  deque;
+            Job_Slot   slots[SLOT_COUNT];
+            u32        next_slot = 0;
+            u32        steal_seed;
+        };
+
+        std::vector<Unique<Worker>> workers;
+        std::vector<std::thread>    threads;
+
+        std::mutex       injection_lock;
+        std::deque<Job>  injection_queue;
+
+        // Workers sleep when there is nothing to do, { queued_jobs } is only a hint:
+        std::atomic<int>        queued_jobs   = 0;
+        std::atomic<int>        sleeping      = 0;
+        std::atomic<bool>       stopping      = false;
+        std::mutex              sleep_lock;
+        std::condition_variable wake_up;
+
+    public:
+        /*
+            { worker_count } does not include the main thread, by default one worker per hardware thread
+            is used, minus the main thread.
+        */
+        explicit Job_System(int worker_count = -1);
+        ~Job_System();
+
+        Job_System(const Job_System&)            = delete;
+        Job_System& operator=(const Job_System&) = delete;
+
+        /*
+            Schedule { fn() }, the { counter } is incremented now and decremented once the job is done.
+        */
+        template <typename T_Fn>
+        void
+        run(T_Fn&& fn, Job_Counter* counter = nullptr);
+
+        /*
+            Call { fn(int begin, int end) } for every batch of at most { batch_size } indices in
+            [{ begin }, { end }) and wait for all of them.
+        */
+        template <typename T_Fn>
+        void
+        parallel_for(int begin, int end, int batch_size, T_Fn&& fn);
+
+        /*
+            Execute jobs on the calling thread until the { counter } reaches zero.
+        */
+        void
+        wait(const Job_Counter& counter);
+
+        /*
+            Execute at most a single pending job on the calling thread, returns false if there was none.
+        */
+        bool
+        execute_one();
+
+        /*
+            Number of threads executing jobs, including the main thread.
+        */
+        int
+        get_thread_count() const;
+
+        /*
+            Index of the calling thread: 0 for the main thread, 1 and up for the workers, -1 for the rest.
+        */
+        int
+        get_thread_index() const;
+
+    private:
+        /*
+            Copy the job into a slot of the calling thread and push it, or into the injection queue.
+        */
+        void
+        submit(const Job& job);
+
+        Job_Slot&
+        allocate_slot(Worker& worker);
+
+        /*
+            Pop from our own deque, or steal from another one. Returns { nullptr } if there is nothing to do.
+        */
+        Job_Slot*
+        find_job(int thread_index);
+
+        /*
+            Copy the job out, release the slot and run it.
+        */
+        void
+        take_and_execute(Job_Slot& slot);
+
+        void
+        execute(Job& job);
+
+        void
+        worker_fn(int thread_index);
+    };
+
+    /*
+    ## Job_System: template implementations
+    */
+
+    template <typename T_Fn>
+    void
+    Job_System::run(T_Fn&& fn, Job_Counter* counter) {
+        using Fn = std::decay_t<T_Fn>;
+        static_assert(sizeof(Fn) <= JOB_DATA_SIZE, "Job closure is too big, capture by reference instead!");
+        static_assert(alignof(Fn) <= 16, "Job closure alignment is not supported!");
+        static_assert(std::is_trivially_copyable_v<Fn>, "Job closure must be trivially copyable!");
+
+        if (counter != nullptr) {
+            counter->value.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        Job job;
+        job.function = [](Job& job) { (*reinterpret_cast<Fn*>(job.data))(); };
+        job.counter  = counter;
+        new (job.data) Fn(std::forward<T_Fn>(fn));
+
+        submit(job);
+    }
+
+    template <typename T_Fn>
+    void
+    Job_System::parallel_for(int begin, int end, int batch_size, T_Fn&& fn) {
+        if (begin >= end) {
+            return;
+        }
+
+        // A single batch is not worth the trip through the deque:
+        if (batch_size <= 0 || end - begin <= batch_size) {
+            fn(begin, end);
+            return;
+        }
+
+        Job_Counter counter;
+        for (int batch_begin = begin; batch_begin < end; batch_begin += batch_size) {
+            const int batch_end = std::min(batch_begin + batch_size, end);
+            run([&fn, batch_begin, batch_end] { fn(batch_begin, batch_end); }, &counter);
+        }
+
+        wait(counter);
+    }
+
+} // jbx
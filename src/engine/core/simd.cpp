@@ -0,0 +1,78 @@
+
+// Implements:
+#include <engine/core/simd.hpp>
+
+// Dependencies (3rd party):
+#if defined(_MSC_VER) && !defined(__clang__)
+    #include <intrin.h> // __cpuidex, _xgetbv
+#endif
+
+namespace jbx {
+
+    static Simd_Level
+    detect_simd_level() {
+    #if defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64)
+        int info[4];
+        __cpuidex(info, 0, 0);
+        const int max_leaf = info[0];
+
+        __cpuidex(info, 1, 0);
+        const bool has_osxsave = (info[2] & (1 << 27)) != 0;
+        const bool has_fma     = (info[2] & (1 << 12)) != 0;
+
+        // The OS must save the wider registers on context switches, or they can't be used:
+        const u64 enabled_state = has_osxsave ? _xgetbv(0) : 0;
+        const bool saves_ymm    = (enabled_state & 0x06) == 0x06;
+        const bool saves_zmm    = (enabled_state & 0xE6) == 0xE6;
+
+        bool has_avx2    = false;
+        bool has_avx512f = false;
+        if (max_leaf >= 7) {
+            __cpuidex(info, 7, 0);
+            has_avx2    = (info[1] & (1 << 5)) != 0;
+            has_avx512f = (info[1] & (1 << 16)) != 0;
+        }
+
+        if (has_avx512f && has_avx2 && has_fma && saves_zmm) {
+            return Simd_Level_AVX512;
+        }
+
+        if (has_avx2 && has_fma && saves_ymm) {
+            return Simd_Level_AVX2;
+        }
+
+        return Simd_Level_SSE2;
+    #elif defined(__x86_64__)
+        // Checks the OS support too:
+        __builtin_cpu_init();
+
+        const bool has_avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        if (has_avx2 && __builtin_cpu_supports("avx512f")) {
+            return Simd_Level_AVX512;
+        }
+
+        if (has_avx2) {
+            return Simd_Level_AVX2;
+        }
+
+        return Simd_Level_SSE2;
+    #else
+        return Simd_Level_Scalar;
+    #endif
+    }
+
+    Simd_Level
+    get_simd_level() {
+        static const Simd_Level level = detect_simd_level();
+        return level;
+    }
+
+    const char*
+    get_simd_level_name(Simd_Level level) {
+        static const char* names[Simd_Level_Count] = { "Scalar", "SSE2", "AVX2", "AVX-512" };
+
+        ERROR_IF(level >= Simd_Level_Count, "Unknown SIMD level!");
+        return names[level];
+    }
+
+} // jbx
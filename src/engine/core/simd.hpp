@@ -0,0 +1,43 @@
+
+#pragma once
+
+namespace jbx {
+
+    /*
+        Instruction sets of the kernels which are picked at runtime, each level includes the ones before:
+        - { Simd_Level_Scalar }: Plain C++, what the compiler makes of it.
+        - { Simd_Level_SSE2 }:   4 floats per instruction, every x64 CPU has it.
+        - { Simd_Level_AVX2 }:   8 floats per instruction, with FMA.
+        - { Simd_Level_AVX512 }: 16 floats per instruction (AVX-512F), with AVX2.
+    */
+    enum Simd_Level : u8 {
+        Simd_Level_Scalar = 0,
+        Simd_Level_SSE2,
+        Simd_Level_AVX2,
+        Simd_Level_AVX512,
+        Simd_Level_Count
+    };
+
+    /*
+        Functions using intrinsics of a level which is not enabled for the whole build (see the
+        { PROJECT_ENABLE_AVX2 } CMake option) must be marked with its target. MSVC allows any intrinsic
+        anywhere, GCC and Clang need the attribute. They may only be called if { get_simd_level } allows it.
+    */
+#if defined(_MSC_VER) && !defined(__clang__)
+    #define SIMD_TARGET_AVX2
+    #define SIMD_TARGET_AVX512
+#else
+    #define SIMD_TARGET_AVX2   __attribute__((target("avx2,fma")))
+    #define SIMD_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+#endif
+
+    /*
+        Highest level supported by both the CPU and the OS, detected once.
+    */
+    Simd_Level
+    get_simd_level();
+
+    const char*
+    get_simd_level_name(Simd_Level level);
+
+} // jbx
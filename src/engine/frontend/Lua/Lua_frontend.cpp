@@ -4,7 +4,10 @@
 
 // Dependencies:
 #include <engine/core/engine.hpp>
+#include <engine/core/engine_instance.hpp>
 #include <ecs/ecs.hpp>
+#include <features/Collision_System.hpp>
+#include <features/Spatial_Index_System.hpp>
 
 // Dependencies (3rd_party):
 #define SOL_NO_EXCEPTIONS 1
@@ -15,30 +18,47 @@
 */
 namespace jbx {
 
-    struct Script_Context {
+    /*
+        Lua state of a single { Engine_Instance }, every instance runs its own VM.
+        - { lua }: the VM, everything bound into it captures the instance.
+        - { begin, step, end }: user lifecycle functions.
+        - { events }: optional user function, receives the events of the last tick, see { call_events }.
+    */
+    struct Frontend_Context {
+        sol::state    lua;
         sol::function begin;
         sol::function step;
         sol::function end;
+        sol::function events;
     };
 
-    static Rect&
-    get_rect(const Entity& entity) {
-        return get_context<Registry>()->get_component<Rect>(entity);
-    }
+    /*
+        Attach the { entity } to the { parent }, see { Hierarchy_System }. With { keep_world_rect } the child
+        stays where it is, otherwise its current rect is taken as relative to the parent.
+    */
+    static void
+    set_parent(Engine_Instance& instance, Entity entity, Entity parent, bool keep_world_rect) {
+        Registry* registry                   = &instance.registry;
+        const Component_Storage<Rect>& rects = registry->get_storage<Rect>();
+        const Rect rect                      = rects.get(entity.id);
+
+        f32x2 origin;
+        if (registry->is_alive(parent) && rects.contains(parent.id)) {
+            origin = f32x2(rects.get(parent.id).x, rects.get(parent.id).y);
+        }
 
-    static Color&
-    get_color(const Entity& entity) {
-        return get_context<Registry>()->get_component<Color>(entity);
-    }
+        // Adding components may move the entity, so the rect is written last:
+        if (keep_world_rect) {
+            registry->add_component<Local_Rect>(entity, rect.x - origin.x, rect.y - origin.y, rect.z, rect.w);
+        } else {
+            registry->add_component<Local_Rect>(entity, rect.x, rect.y, rect.z, rect.w);
+        }
 
-    static Velocity&
-    get_velocity(const Entity& entity) {
-        return get_context<Registry>()->get_component<Velocity>(entity);
-    }
+        registry->add_component<Parent>(entity, parent);
 
-    static Texture&
-    get_texture(const Entity& entity) {
-        return get_context<Registry>()->get_component<Texture>(entity);
+        if (!keep_world_rect) {
+            registry->get_component<Rect>(entity) = Rect(origin.x + rect.x, origin.y + rect.y, rect.z, rect.w);
+        }
     }
 
     /*
@@ -47,13 +67,14 @@ namespace jbx {
         - Most default to zero but some are required, if for instance you specify any of the fields of { Rect }
           component, then you must also make sure to include non-zero { width, height } fields. For now this
           raises an error in debug builds only, but we will have a similar behavior for release builds too.
+        - With a { parent } entity, { x, y } are relative to the parent rect and the entity follows it.
     */
     static sol::table
-    create_entity(sol::table& def) {
-        Unique<Registry>& registry = get_context<Registry>();
-        Entity entity              = registry->create_entity();
+    create_entity(Engine_Instance& instance, sol::table& def) {
+        Registry* registry = &instance.registry;
+        Entity entity      = registry->create_entity();
 
-        sol::table lua_entity_info = get_context<sol::state>()->create_table();
+        sol::table lua_entity_info = instance.frontend->lua.create_table();
         lua_entity_info["id"]      = entity;
 
         // Rect:
@@ -74,6 +95,14 @@ namespace jbx {
             );
         }
 
+        // Parent, the rect is relative to the parent rect:
+        if (def["parent"].valid()) {
+            ERROR_IF(!lua_entity_info["rect"].valid(), "Entity with a { parent } must have a rect!");
+
+            lua_entity_info["parent"] = true;
+            set_parent(instance, entity, def["parent"].get<Entity>(), false);
+        }
+
         // Velocity:
         if (def["hspeed"].valid() || def["vspeed"].valid()) {
             lua_entity_info["velocity"] = true;
@@ -130,8 +159,77 @@ namespace jbx {
         return lua_entity_info;
     }
 
+    /*
+        Compile an entity definition into a { Prefab }, so { cv.spawn } does not look at the table again.
+        Takes the same fields as { create_entity }, but { text } is not supported: { Text } is not trivially
+        copyable. With a { parent } the rect is relative to the parent, and placed in the next update.
+    */
+    static Prefab
+    create_prefab(sol::table& def) {
+        Prefab prefab;
+
+        ERROR_IF(def["text"].valid(), "Prefabs can not have { text }!");
+
+        // Rect:
+        if (def["x"].valid() || def["y"].valid() || def["width"].valid() || def["height"].valid()) {
+            ERROR_IF(
+                def["width"].get_or(0.0f) <= 0 || def["height"].get_or(0.0f) <= 0,
+                "Must specify both { width } and { height } of an entity!"
+            );
+
+            prefab.add<Rect>(
+                def["x"].get_or(0.0f),
+                def["y"].get_or(0.0f),
+                def["width"].get_or(0.0f),
+                def["height"].get_or(0.0f)
+            );
+        }
+
+        // Parent, the world rect is computed by the { Hierarchy_System }:
+        if (def["parent"].valid()) {
+            ERROR_IF(!prefab.has<Rect>(), "Entity with a { parent } must have a rect!");
+
+            const Rect& rect = prefab.get<Rect>();
+            prefab.add<Local_Rect>(rect.x, rect.y, rect.z, rect.w);
+            prefab.add<Parent>(def["parent"].get<Entity>());
+        }
+
+        // Velocity:
+        if (def["hspeed"].valid() || def["vspeed"].valid()) {
+            prefab.add<Velocity>(
+                def["hspeed"].get_or(0.0f),
+                def["vspeed"].get_or(0.0f)
+            );
+        }
+
+        // Color:
+        if (def["r"].valid() || def["g"].valid() || def["b"].valid() || def["a"].valid()) {
+            prefab.add<Color>(
+                def["r"].get_or(0),
+                def["g"].get_or(0),
+                def["b"].get_or(0),
+                def["a"].get_or(255)
+            );
+        }
+
+        // Texture:
+        if (def["texture_id"].valid()) {
+            prefab.add<Texture>(
+                def["texture_id"].get_or(0),
+                f32x4(
+                    def["texture_x"].get_or(0.0f),
+                    def["texture_y"].get_or(0.0f),
+                    def["texture_width"].get_or(0.0f),
+                    def["texture_height"].get_or(0.0f)
+                )
+            );
+        }
+
+        return prefab;
+    }
+
     static inline void
-    bind_engine_api(sol::state& lua) {
+    bind_engine_api(Engine_Instance& instance, sol::state& lua) {
         /*
         ## Types
         */
@@ -154,7 +252,8 @@ namespace jbx {
 
         lua.new_usertype<Entity>(
             "Entity",
-            "id", &Entity::id
+            "id",         &Entity::id,
+            "generation", &Entity::generation
         );
 
         lua.new_usertype<Rect>(
@@ -165,6 +264,19 @@ namespace jbx {
             "height", &Rect::w
         );
 
+        lua.new_usertype<Local_Rect>(
+            "Local_Rect",
+            "x",      &Local_Rect::x,
+            "y",      &Local_Rect::y,
+            "width",  &Local_Rect::z,
+            "height", &Local_Rect::w
+        );
+        lua.new_usertype<Contact>(
+            "Contact",
+            "a", &Contact::a,
+            "b", &Contact::b
+        );
+
         lua.new_usertype<Texture>(
             "Texture",
             sol::constructors<Texture(int, f32x4)>(),
@@ -194,6 +306,12 @@ namespace jbx {
             "color", &Text::color
         );
 
+        lua.new_usertype<Prefab>(
+            "Prefab",
+            sol::no_constructor,
+            "component_count", sol::property(&Prefab::get_component_count)
+        );
+
         lua.new_enum<Keyboard_Key>("Key", {
             { "A", Keyboard_Key::KEY_A },
             { "B", Keyboard_Key::KEY_B },
@@ -227,21 +345,157 @@ namespace jbx {
         ## Functions
         */
         sol::table api_bindings = lua.create_table(); // @todo make this namespace the types too...
+        Engine_Instance* owner  = &instance;
+
+        // Lua specific, bound to the registry of this instance:
+        api_bindings.set_function("create_entity", [owner](sol::table def) {
+            return create_entity(*owner, def);
+        });
 
-        // Lua specific:
-        api_bindings.set_function("create_entity", create_entity);
-        api_bindings.set_function("get_rect", get_rect);
-        api_bindings.set_function("get_color", get_color);
-        api_bindings.set_function("get_velocity", get_velocity);
-        api_bindings.set_function("get_texture", get_texture);
-
-        // Directly from engine API:
-        api_bindings.set_function("clear_color", set_clear_color);
-        api_bindings.set_function("is_key_pressed", is_key_pressed);
-        api_bindings.set_function("load_texture", load_texture);
-        api_bindings.set_function("load_sound", load_sound);
-        api_bindings.set_function("play_sound", play_sound);
-        api_bindings.set_function("load_font", load_font);
+        /*
+            Prefabs, see { Registry::instantiate }. The definition is compiled once with { prefab }, { spawn }
+            then creates { count } entities from it in bulk and returns an array of them.
+        */
+        api_bindings.set_function("prefab", [](sol::table def) {
+            return create_prefab(def);
+        });
+        api_bindings.set_function("spawn", [owner](const Prefab& prefab, int count) {
+            std::vector<Entity> result;
+            owner->registry.instantiate(prefab, count, result);
+            return sol::as_table(std::move(result));
+        });
+
+        // Room for { count } entities, before spawning a large level, see { Registry::reserve }:
+        api_bindings.set_function("reserve", [owner](int count) {
+            owner->registry.reserve(count);
+        });
+
+        api_bindings.set_function("get_rect",[owner](const Entity& entity) -> Rect& {
+            return owner->registry.get_component<Rect>(entity);
+        });
+        api_bindings.set_function("get_color", [owner](const Entity& entity) -> Color& {
+            return owner->registry.get_component<Color>(entity);
+        });
+        api_bindings.set_function("get_velocity", [owner](const Entity& entity) -> Velocity& {
+            return owner->registry.get_component<Velocity>(entity);
+        });
+        api_bindings.set_function("get_texture", [owner](const Entity& entity) -> Texture& {
+            return owner->registry.get_component<Texture>(entity);
+        });
+
+        /*
+            Hierarchy, see { Hierarchy_System }. Children are moved through their local rect, { set_parent }
+            keeps the child where it is and { clear_parent } leaves it at its last rect.
+        */
+        api_bindings.set_function("get_local_rect", [owner](const Entity& entity) -> Local_Rect& {
+            return owner->registry.get_component<Local_Rect>(entity);
+        });
+        api_bindings.set_function("set_parent", [owner](const Entity& entity, const Entity& parent) {
+            set_parent(*owner, entity, parent, true);
+        });
+        api_bindings.set_function("clear_parent", [owner](const Entity& entity) {
+            owner->registry.remove_component<Parent>(entity);
+            owner->registry.remove_component<Local_Rect>(entity);
+        });
+
+        /*
+            Scripts may hold on to entity handles for a long time, this lets them check if the handle is still
+            valid before using it.
+        */
+        api_bindings.set_function("is_alive", [owner](const Entity& entity) {
+            return owner->registry.is_alive(entity);
+        });
+
+        /*
+            Share of the component reads of systems which are in memory order, see { Registry::get_pool_locality }.
+            For profiling, it walks every system.
+        */
+        api_bindings.set_function("get_pool_locality", [owner]() {
+            return owner->registry.get_pool_locality();
+        });
+
+        /*
+            Memory held by the registry, see { Registry::get_memory_report }. Returns an array of
+            { name, bytes, pages } tables, for profiling.
+        */
+        api_bindings.set_function("get_memory_report", [owner, &lua]() {
+            std::vector<Memory_Usage> report;
+            owner->registry.get_memory_report(report);
+
+            sol::table table = lua.create_table(static_cast<int>(report.size()), 0);
+            for (int index = 0; index < static_cast<int>(report.size()); index++) {
+                table[index + 1] = lua.create_table_with(
+                    "name", report[index].name, "bytes", report[index].bytes, "pages", report[index].page_count
+                );
+            }
+
+            return table;
+        });
+
+        /*
+            Spatial queries, see { Spatial_Index_System }. Each returns an array of entities, they see the rects
+            as of the end of the previous step, so entities created or moved in this step are not found yet.
+        */
+        api_bindings.set_function("query_region", [owner](f32 x, f32 y, f32 width, f32 height) {
+            std::vector<Entity> result;
+            owner->registry.get_system<Spatial_Index_System>().query_region(Rect(x, y, width, height), result);
+            return sol::as_table(std::move(result));
+        });
+        api_bindings.set_function("query_point", [owner](f32 x, f32 y) {
+            std::vector<Entity> result;
+            owner->registry.get_system<Spatial_Index_System>().query_point(f32x2(x, y), result);
+            return sol::as_table(std::move(result));
+        });
+        api_bindings.set_function("query_nearest", [owner](f32 x, f32 y, int count) {
+            std::vector<Entity> result;
+            owner->registry.get_system<Spatial_Index_System>().query_nearest(f32x2(x, y), count, result);
+            return sol::as_table(std::move(result));
+        });
+
+        /*
+            Pairs of overlapping rects found by the { Collision_System } in the previous step.
+        */
+        api_bindings.set_function("get_contacts", [owner]() {
+            return sol::as_table(owner->registry.get_system<Collision_System>().get_contacts());
+        });
+
+        /*
+            Save the world into { assets/snapshots }, or load it back instead of creating every entity again.
+            Loading must happen before any entity is created, e.g. at the start of { game_begin }. { Text } is
+            not trivially copyable, so it's not part of the snapshot.
+        */
+        api_bindings.set_function("save_snapshot", [owner](const std::string& file_name) {
+            return Snapshot::save<Rect, Color, Velocity, Texture, Parent, Local_Rect>(
+                owner->registry, snapshot_path(owner->config, file_name)
+            );
+        });
+        api_bindings.set_function("load_snapshot", [owner](const std::string& file_name) {
+            return Snapshot::load<Rect, Color, Velocity, Texture, Parent, Local_Rect>(
+                owner->registry, snapshot_path(owner->config, file_name)
+            );
+        });
+
+        /*
+            Directly from engine API. Headless instances have no backend, scripts get stubs which do nothing
+            so the same game runs either way, resources come back with id 0.
+        */
+        if (instance.config.flags & Engine_Flags_Headless) {
+            api_bindings.set_function("clear_color", [](const u8x4&) {});
+            api_bindings.set_function("is_key_pressed", [](Keyboard_Key) { return false; });
+            api_bindings.set_function("load_texture", [](const std::string&) { return Texture(); });
+            api_bindings.set_function("load_sound", [](const std::string&, f32 volume, f32 pitch) {
+                return Sound(0, volume, pitch);
+            });
+            api_bindings.set_function("play_sound", [](Sound&) {});
+            api_bindings.set_function("load_font", [](const std::string&, int) { return Font(); });
+        } else {
+            api_bindings.set_function("clear_color", set_clear_color);
+            api_bindings.set_function("is_key_pressed", is_key_pressed);
+            api_bindings.set_function("load_texture", load_texture);
+            api_bindings.set_function("load_sound", load_sound);
+            api_bindings.set_function("play_sound", play_sound);
+            api_bindings.set_function("load_font", load_font);
+        }
 
         lua["cv"] = api_bindings;
     }
@@ -273,14 +527,59 @@ namespace jbx {
         )");
     }
 
+    /*
+        Copy the events into a new array table, in one go instead of growing it event by event.
+    */
+    template <typename T_Event, typename T_Fn>
+    static sol::table
+    create_event_table(sol::state& lua, Event_Span<T_Event> events, T_Fn&& to_lua) {
+        sol::table table = lua.create_table(events.size(), 0);
+        for (int index = 0; index < events.size(); index++) {
+            table[index + 1] = to_lua(events[index]);
+        }
+
+        return table;
+    }
+
+    /*
+        Hand every event of the last tick to the user { game_events } function, in a single call per step
+        instead of one callback per event:
+
+            function game_events(events)
+                for _, key in ipairs(events.keys) do ... end          -- Key
+                for _, contact in ipairs(events.contacts) do ... end  -- Contact
+            end
+
+        Nothing is called when there were no events.
+    */
+    static void
+    call_events(Engine_Instance& instance) {
+        Shared<Frontend_Context>& context = instance.frontend;
+        Event_Bus& event_bus              = instance.registry.get_events();
+
+        const Event_Span<Key_Event> keys   = event_bus.read<Key_Event>();
+        const Event_Span<Contact> contacts = event_bus.read<Contact>();
+        if (keys.empty() && contacts.empty()) {
+            return;
+        }
+
+        sol::table events  = context->lua.create_table(0, 2);
+        events["keys"]     = create_event_table(context->lua, keys, [](const Key_Event& event) { return event.key; });
+        events["contacts"] = create_event_table(context->lua, contacts, [](const Contact& event) { return event; });
+
+        context->events(events);
+    }
+
     void
-    frontend_start() {
-        sol::state& lua = *get_context<sol::state>();
+    frontend_start(Engine_Instance& instance) {
+        instance.frontend                 = std::make_shared<Frontend_Context>();
+        Shared<Frontend_Context>& context = instance.frontend;
+        sol::state& lua                   = context->lua;
 
         /*
             Engine will load Lua sources from the { src } directory relative to the current working directory.
         */
-        std::string project_root_dir = get_context<Engine_Config>()->root_dir;
+        std::string project_root_dir = instance.config.root_dir;
         std::string project_pattern  = fmt::format(";{}src/?.lua", project_root_dir);
         std::string project_main     = fmt::format("{}src/main.lua", project_root_dir);
 
@@ -295,7 +594,7 @@ namespace jbx {
         lua["package"]["path"] = lua["package"]["path"].get<std::string>() + project_pattern;
 
         // Bind the API:
-        bind_engine_api(lua);
+        bind_engine_api(instance, lua);
         preload_common_api(lua);
 
         // Validate the main script:
@@ -316,7 +615,6 @@ namespace jbx {
             Defaults will not print anything in the final version, because it's rather annoying to spam that
             without a choice.
         */
-        Unique<Script_Context>& context = get_context<Script_Context>();
 
         if (!lua["game_begin"].valid()) {
             cstr_t default_begin = R"(
@@ -349,21 +647,30 @@ namespace jbx {
         context->step   = lua["game_step"];
         context->end    = lua["game_end"];
 
+        // Unlike the others { game_events } has no default, games which don't read events don't pay for them:
+        if (lua["game_events"].valid()) {
+            context->events = lua["game_events"];
+        }
+
         // Run user { begin } function:
         context->begin();
     }
 
     void
-    frontend_step(f64 delta_time) {
-        Unique<Script_Context>& context = get_context<Script_Context>();
+    frontend_step(Engine_Instance& instance, f64 delta_time) {
+        Shared<Frontend_Context>& context = instance.frontend;
+
+        if (context->events.valid()) {
+            call_events(instance);
+        }
 
         // Run user { step } function:
         context->step(delta_time);
     }
 
     void
-    frontend_stop() {
-        Unique<Script_Context>& context = get_context<Script_Context>();
+    frontend_stop(Engine_Instance& instance) {
+        Shared<Frontend_Context>& context = instance.frontend;
 
         // Run user { end } function:
         context->end();
@@ -2,26 +2,216 @@
 // Implements:
 #include <features/Basic_Velocity_System.hpp>
 
-// Dependencies:
-#include <engine/core/engine.hpp>
+// Dependencies (3rd party):
+#include <immintrin.h>
 
 namespace jbx {
 
-    Basic_Velocity_System::Basic_Velocity_System() {
+    /*
+    ## Kernels
+        Rects are 4 floats { x, y, width, height } and velocities 2 floats { x, y }, so a register holds fewer
+        entities than floats: the velocities are spread into the x and y lanes and only those lanes are
+        written back. AVX2 and AVX-512 fuse the multiply and the add (as compilers may do with the scalar
+        kernel too), so results can differ from the scalar kernel in the last bit.
+    */
+
+    static void
+    integrate_velocities_scalar(Rect* rects, const Velocity* velocities, int count, f32 delta_time) {
+        for (int i = 0; i < count; i++) {
+            rects[i].x += velocities[i].x * delta_time;
+            rects[i].y += velocities[i].y * delta_time;
+        }
+    }
+
+#if defined(__SSE2__) || defined(_M_X64)
+    static void
+    integrate_velocities_sse2(Rect* rects, const Velocity* velocities, int count, f32 delta_time) {
+        f32* positions    = reinterpret_cast<f32*>(rects);
+        const f32* speeds = reinterpret_cast<const f32*>(velocities);
+
+        const __m128 delta = _mm_set1_ps(delta_time);
+        const __m128 zero  = _mm_setzero_ps();
+
+        // 2 entities per iteration, one register per rect:
+        int i = 0;
+        for (; i + 2 <= count; i += 2) {
+            const __m128 pair = _mm_mul_ps(_mm_loadu_ps(speeds + 2 * i), delta);
+
+            // { x, y, 0, 0 } of each velocity, adding 0 leaves width and height as they are:
+            const __m128 first  = _mm_movelh_ps(pair, zero);
+            const __m128 second = _mm_movehl_ps(zero, pair);
+
+            _mm_storeu_ps(positions + 4 * i, _mm_add_ps(_mm_loadu_ps(positions + 4 * i), first));
+            _mm_storeu_ps(positions + 4 * i + 4, _mm_add_ps(_mm_loadu_ps(positions + 4 * i + 4), second));
+        }
+
+        integrate_velocities_scalar(rects + i, velocities + i, count - i, delta_time);
+    }
+
+    SIMD_TARGET_AVX2 static void
+    integrate_velocities_avx2(Rect* rects, const Velocity* velocities, int count, f32 delta_time) {
+        f32* positions    = reinterpret_cast<f32*>(rects);
+        const f32* speeds = reinterpret_cast<const f32*>(velocities);
+
+        const __m256 delta       = _mm256_set1_ps(delta_time);
+        const __m256i first_two  = _mm256_setr_epi32(0, 1, 0, 0, 2, 3, 0, 0);
+        const __m256i second_two = _mm256_setr_epi32(4, 5, 0, 0, 6, 7, 0, 0);
+
+        // 4 entities per iteration, one register of velocities and two of rects:
+        int i = 0;
+        for (; i + 4 <= count; i += 4) {
+            const __m256 speed  = _mm256_loadu_ps(speeds + 2 * i);
+            const __m256 first  = _mm256_loadu_ps(positions + 4 * i);
+            const __m256 second = _mm256_loadu_ps(positions + 4 * i + 8);
+
+            // Lanes 0, 1, 4 and 5 are x and y, the rest keep the width and height:
+            const __m256 moved_first  = _mm256_fmadd_ps(_mm256_permutevar8x32_ps(speed, first_two), delta, first);
+            const __m256 moved_second = _mm256_fmadd_ps(_mm256_permutevar8x32_ps(speed, second_two), delta, second);
+
+            _mm256_storeu_ps(positions + 4 * i, _mm256_blend_ps(first, moved_first, 0x33));
+            _mm256_storeu_ps(positions + 4 * i + 8, _mm256_blend_ps(second, moved_second, 0x33));
+        }
+
+        integrate_velocities_scalar(rects + i, velocities + i, count - i, delta_time);
+    }
+
+    SIMD_TARGET_AVX512 static void
+    integrate_velocities_avx512(Rect* rects, const Velocity* velocities, int count, f32 delta_time) {
+        f32* positions    = reinterpret_cast<f32*>(rects);
+        const f32* speeds = reinterpret_cast<const f32*>(velocities);
+
+        const __m512 delta      = _mm512_set1_ps(delta_time);
+        const __m512i spread[2] = {
+            _mm512_setr_epi32( 0,  1, 0, 0,  2,  3, 0, 0,  4,  5, 0, 0,  6,  7, 0, 0),
+            _mm512_setr_epi32( 8,  9, 0, 0, 10, 11, 0, 0, 12, 13, 0, 0, 14, 15, 0, 0),
+        };
+
+        // 8 entities per iteration, one register of velocities and two of rects:
+        int i = 0;
+        for (; i + 8 <= count; i += 8) {
+            const __m512 speed = _mm512_loadu_ps(speeds + 2 * i);
+
+            for (int half = 0; half < 2; half++) {
+                f32* half_positions       = positions + 4 * i + 16 * half;
+                const __m512 rect         = _mm512_loadu_ps(half_positions);
+                const __m512 spread_speed = _mm512_maskz_permutexvar_ps(0x3333, spread[half], speed);
+
+                // Only the x and y lanes are written, the others keep the rect:
+                _mm512_storeu_ps(half_positions, _mm512_mask3_fmadd_ps(spread_speed, delta, rect, 0x3333));
+            }
+        }
+
+        integrate_velocities_avx2(rects + i, velocities + i, count - i, delta_time);
+    }
+#endif
+
+    void
+    integrate_velocities(Rect* rects, const Velocity* velocities, int count, f32 delta_time, Simd_Level level) {
+        EXPECT(level <= get_simd_level(), "SIMD level is not supported by this CPU!");
+
+    #if defined(__SSE2__) || defined(_M_X64)
+        switch (level) {
+            case Simd_Level_AVX512: integrate_velocities_avx512(rects, velocities, count, delta_time); return;
+            case Simd_Level_AVX2:   integrate_velocities_avx2(rects, velocities, count, delta_time);   return;
+            case Simd_Level_SSE2:   integrate_velocities_sse2(rects, velocities, count, delta_time);   return;
+            default: break;
+        }
+    #endif
+
+        integrate_velocities_scalar(rects, velocities, count, delta_time);
+    }
+
+    /*
+    ## Basic_Velocity_System: implementation
+    */
+
+    Basic_Velocity_System::Basic_Velocity_System()
+    : simd_level(get_simd_level()) {
         component_mask.add<Rect>();
         component_mask.add<Velocity>();
+
+        reads<Velocity>();
+        writes<Rect>();
     }
 
     void
     Basic_Velocity_System::update(f64 delta_time) {
-        Unique<Registry>& registry = get_context<Registry>();
-        for (auto& entity: entities) {
-            Rect& transform    = registry->get_component<Rect>(entity);
-            Velocity& velocity = registry->get_component<Velocity>(entity);
+        const f32 delta = static_cast<f32>(delta_time);
 
-            transform.x += velocity.x * delta_time;
-            transform.y += velocity.y * delta_time;
-        }
+    #if PROJECT_ECS_STORAGE_ARCHETYPES
+        chunks.clear();
+        registry->view<Rect, Velocity>().each_chunk([&](int count, const int* entity_ids, Rect* rects, Velocity* velocities) {
+            chunks.push_back({ count, entity_ids, rects, velocities });
+        });
+
+        // Every chunk only touches its own rows, so they can run in parallel:
+        get_context<Job_System>()->parallel_for(0, static_cast<int>(chunks.size()), 8, [&](int begin, int end) {
+            for (int index = begin; index < end; index++) {
+                const Chunk& chunk = chunks[index];
+                integrate_velocities(chunk.rects, chunk.velocities, chunk.count, delta, simd_level);
+                registry->mark_changed<Rect>(chunk.entity_ids, chunk.count);
+            }
+        });
+    #else
+        Pool<Rect>& rects                = registry->get_pool<Rect>();
+        const Pool<Velocity>& velocities = registry->get_pool<Velocity>();
+        const Velocity* velocity_data    = velocities.get_data();
+        const Entity* batch_entities     = entities.data();
+
+        // Rows { rect_index.. } and { velocity_index.. } of both pools belong to the same { count } entities:
+        auto integrate_run = [&](int rect_index, int velocity_index, int count) {
+            if (count < 4) {
+                // Too short for a register, spare the dispatch to the kernel:
+                integrate_velocities_scalar(&rects[rect_index], velocity_data + velocity_index, count, delta);
+            } else {
+                integrate_velocities(&rects[rect_index], velocity_data + velocity_index, count, delta, simd_level);
+            }
+
+            for (int index = rect_index + 1; index < rect_index + count; index++) {
+                rects.mark_changed(index);
+            }
+        };
+
+        /*
+            Entities which follow each other in the system and in both pools are contiguous rows like the
+            chunks of an archetype, they are moved with one call of the kernel. Once the pools are sorted
+            by the same keys as the system (see { Registry::set_pool_order }) most entities are in long
+            runs, otherwise every entity is a run of its own. The indices are looked up per entity either
+            way, so the runs cost nothing over moving one entity at a time.
+        */
+        get_context<Job_System>()->parallel_for(0, static_cast<int>(entities.size()), DEFAULT_BATCH_SIZE, [&](int begin, int end) {
+            int run_rect_index     = 0;
+            int run_velocity_index = 0;
+            int run_count          = 0;
+
+            for (int i = begin; i < end; i++) {
+                const int rect_index     = rects.index_of(batch_entities[i].id);
+                const int velocity_index = velocities.index_of(batch_entities[i].id);
+                if (rect_index == run_rect_index + run_count && velocity_index == run_velocity_index + run_count) {
+                    run_count += 1;
+                    continue;
+                }
+
+                if (run_count > 0) {
+                    integrate_run(run_rect_index, run_velocity_index, run_count);
+                }
+
+                run_rect_index     = rect_index;
+                run_velocity_index = velocity_index;
+                run_count          = 1;
+            }
+
+            if (run_count > 0) {
+                integrate_run(run_rect_index, run_velocity_index, run_count);
+            }
+        });
+    #endif
+    }
+
+    void
+    Basic_Velocity_System::set_simd_level(Simd_Level level) {
+        ERROR_IF(level > get_simd_level(), "SIMD level is not supported by this CPU!");
+        simd_level = level;
     }
 
-} // jbx
\ No newline at end of file
+} // jbx
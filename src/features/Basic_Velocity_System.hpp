@@ -1,19 +1,55 @@
 
 #pragma once
 #include <ecs/ecs.hpp>
+#include <engine/core/engine.hpp>
+#include <engine/core/simd.hpp>
 
 namespace jbx {
 
+    /*
+        Move { count } rects by their velocities over { delta_time }, only x and y change. This is the kernel
+        { Basic_Velocity_System } runs over contiguous rows, { level } must be supported by the CPU (see
+        { get_simd_level }). Levels with FMA may differ from the others in the last bit.
+    */
+    void
+    integrate_velocities(Rect* rects, const Velocity* velocities, int count, f32 delta_time, Simd_Level level);
+
     /*
         Modifies entity position based on the current velocity.
+
+        With archetypes, the rects and velocities of a chunk are contiguous arrays, chunks are moved in
+        parallel with { integrate_velocities } at the { Simd_Level } of the CPU. With pools the same goes for
+        runs of entities which are next to each other in both pools, which is how the engine keeps them by
+        default (see { Engine_Config::pool_order }). Entities between which the pools differ, e.g. rects
+        without velocity, end a run. In unsorted pools every entity is a run of its own and looks both
+        components up, there the kernel gains nothing.
     */
     class Basic_Velocity_System final : public Base_System {
+    private:
+        struct Chunk {
+            int         count;
+            const int*  entity_ids;
+            Rect*       rects;
+            Velocity*   velocities;
+        };
+
+        Simd_Level         simd_level;
+
+        // Archetypes only:
+        std::vector<Chunk> chunks;
+
     public:
         Basic_Velocity_System();
         ~Basic_Velocity_System() = default;
 
         void
         update(f64 delta_time) override;
+
+        /*
+            Use a lower level than the CPU supports, e.g. to compare them.
+        */
+        void
+        set_simd_level(Simd_Level level);
     };
 
 } // jbx
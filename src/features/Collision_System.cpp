@@ -0,0 +1,366 @@
+
+// Implements:
+#include <features/Collision_System.hpp>
+
+// Dependencies:
+#include <engine/core/job_system.hpp>
+
+// Dependencies (3rd party):
+#include <cmath>
+#include <cstring>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+    #include <intrin.h> // _BitScanForward
+#endif
+
+namespace jbx {
+
+    /*
+        Number of shifts per rect the insertion sort may do before the radix sort takes over, rects which
+        moved past more than a few neighbours are better off sorted from scratch.
+    */
+    static constexpr s64 INSERTION_SORT_BUDGET = 8;
+
+    /*
+        Bounds past the last rect, with a { min_x } of infinity, so every sweep ends on its own and a whole
+        SIMD register can be loaded from any rect.
+    */
+    static constexpr int SWEEP_PADDING = 8;
+
+    static constexpr int RADIX_BITS    = 11;
+    static constexpr int RADIX_BUCKETS = 1 << RADIX_BITS;
+    static constexpr int RADIX_PASSES  = (32 + RADIX_BITS - 1) / RADIX_BITS;
+
+    /*
+        Bits of the float which compare as unsigned integers in the same order as the floats.
+    */
+    static inline u32
+    to_radix_key(f32 value) {
+        u32 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+
+        return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+    }
+
+    /*
+        Add a contact of rect { i } for every set bit of { overlapping }, bit 0 is rect { j }.
+    */
+    static inline void
+    add_contacts(const Entity* entities, int i, int j, int overlapping, std::vector<Contact>& result) {
+        while (overlapping != 0) {
+        #if defined(_MSC_VER)
+            unsigned long lane;
+            _BitScanForward(&lane, static_cast<unsigned long>(overlapping));
+        #else
+            const int lane = __builtin_ctz(static_cast<unsigned int>(overlapping));
+        #endif
+            result.push_back({ entities[i], entities[j + static_cast<int>(lane)] });
+
+            // Clear the lowest set bit:
+            overlapping &= overlapping - 1;
+        }
+    }
+
+    /*
+    ## Collision_System: implementation
+    */
+
+    Collision_System::Collision_System(bool parallel)
+    : parallel(parallel) {
+        component_mask.add<Rect>();
+        reads<Rect>();
+    }
+
+    void
+    Collision_System::update(f64) {
+        if (removed_count > 0) {
+            compact();
+        }
+
+        // Entities which joined since the last run already have their bounds, only moved rects are read:
+        registry->each_changed<Rect>(get_last_run_tick(), [&](Entity entity, const Rect& rect) {
+            if (entity.id < static_cast<int>(sweep_positions.size()) && sweep_positions[entity.id] != NO_POSITION) {
+                set_bounds(sweep_positions[entity.id], rect);
+            }
+        });
+
+        const int count = static_cast<int>(sweep_entities.size());
+        if (sort_bounds()) {
+            for (int i = 0; i < count; i++) {
+                sweep_positions[sweep_entities[i].id] = i;
+            }
+        }
+
+        min_x.resize(count + SWEEP_PADDING, INFINITY);
+        max_x.resize(count + SWEEP_PADDING, INFINITY);
+        min_y.resize(count + SWEEP_PADDING, INFINITY);
+        max_y.resize(count + SWEEP_PADDING, INFINITY);
+
+        contacts.clear();
+        if (!parallel) {
+            sweep(0, count, contacts);
+        } else {
+            // Every batch has its own list, they are joined in batch order:
+            const int batch_size  = DEFAULT_BATCH_SIZE;
+            const int batch_count = (count + batch_size - 1) / batch_size;
+            if (static_cast<int>(batch_contacts.size()) < batch_count) {
+                batch_contacts.resize(batch_count);
+            }
+
+            get_context<Job_System>()->parallel_for(0, count, batch_size, [&](int begin, int end) {
+                std::vector<Contact>& batch = batch_contacts[begin / batch_size];
+                batch.clear();
+                sweep(begin, end, batch);
+            });
+
+            for (int batch = 0; batch < batch_count; batch++) {
+                contacts.insert(contacts.end(), batch_contacts[batch].begin(), batch_contacts[batch].end());
+            }
+        }
+
+        min_x.resize(count);
+        max_x.resize(count);
+        min_y.resize(count);
+        max_y.resize(count);
+
+        // Readers of the event queue get the contacts of this update in the next frame, in one block:
+        registry->get_events().send(contacts.data(), static_cast<int>(contacts.size()));
+    }
+
+    const std::vector<Contact>&
+    Collision_System::get_contacts() const {
+        return contacts;
+    }
+
+    void
+    Collision_System::set_parallel(bool enabled) {
+        parallel = enabled;
+    }
+
+    void
+    Collision_System::on_entity_added(Entity entity) {
+        if (entity.id >= static_cast<int>(sweep_positions.size())) {
+            sweep_positions.resize(entity.id + 1, NO_POSITION);
+        }
+
+        // New rects join at the end, the sort moves them into place:
+        const int position = static_cast<int>(sweep_entities.size());
+        sweep_positions[entity.id] = position;
+        sweep_entities.push_back(entity);
+
+        min_x.resize(position + 1);
+        max_x.resize(position + 1);
+        min_y.resize(position + 1);
+        max_y.resize(position + 1);
+
+        const Component_Storage<Rect>& rects = registry->get_storage<Rect>();
+        set_bounds(position, rects.get(entity.id));
+    }
+
+    void
+    Collision_System::on_entity_removed(Entity entity) {
+        int& position = sweep_positions[entity.id];
+        EXPECT(position != NO_POSITION, "Entity is not in the sweep order!");
+
+        sweep_entities[position].id = NO_POSITION;
+        position                    = NO_POSITION;
+        removed_count              += 1;
+    }
+
+    void
+    Collision_System::compact() {
+        const int count = static_cast<int>(sweep_entities.size());
+
+        int kept = 0;
+        for (int i = 0; i < count; i++) {
+            if (sweep_entities[i].id == NO_POSITION) {
+                continue;
+            }
+
+            sweep_entities[kept] = sweep_entities[i];
+            min_x[kept]          = min_x[i];
+            max_x[kept]          = max_x[i];
+            min_y[kept]          = min_y[i];
+            max_y[kept]          = max_y[i];
+
+            sweep_positions[sweep_entities[kept].id] = kept;
+            kept += 1;
+        }
+
+        sweep_entities.resize(kept, Entity(NO_POSITION));
+        min_x.resize(kept);
+        max_x.resize(kept);
+        min_y.resize(kept);
+        max_y.resize(kept);
+
+        removed_count = 0;
+    }
+
+    bool
+    Collision_System::sort_bounds() {
+        const int count = static_cast<int>(sweep_entities.size());
+        s64 budget      = INSERTION_SORT_BUDGET * count;
+        bool sorted     = true;
+
+        for (int i = 1; i < count; i++) {
+            if (min_x[i - 1] <= min_x[i]) {
+                continue;
+            }
+
+            const Entity entity = sweep_entities[i];
+            const f32 left      = min_x[i];
+            const f32 right     = max_x[i];
+            const f32 top       = min_y[i];
+            const f32 bottom    = max_y[i];
+
+            int j = i;
+            for (; j > 0 && min_x[j - 1] > left; j--) {
+                sweep_entities[j] = sweep_entities[j - 1];
+                min_x[j]          = min_x[j - 1];
+                max_x[j]          = max_x[j - 1];
+                min_y[j]          = min_y[j - 1];
+                max_y[j]          = max_y[j - 1];
+            }
+
+            sweep_entities[j] = entity;
+            min_x[j]          = left;
+            max_x[j]          = right;
+            min_y[j]          = top;
+            max_y[j]          = bottom;
+            sorted            = false;
+
+            // Everything is consistent after every insertion, so the radix sort can take over from here:
+            budget -= i - j;
+            if (budget < 0) {
+                sort_bounds_from_scratch();
+                break;
+            }
+        }
+
+        return !sorted;
+    }
+
+    void
+    Collision_System::sort_bounds_from_scratch() {
+        const int count = static_cast<int>(sweep_entities.size());
+
+        for (int buffer = 0; buffer < 2; buffer++) {
+            radix_keys[buffer].resize(count);
+            radix_order[buffer].resize(count);
+        }
+
+        for (int i = 0; i < count; i++) {
+            radix_keys[0][i]  = to_radix_key(min_x[i]);
+            radix_order[0][i] = i;
+        }
+
+        // Least significant digit first, every pass is stable so equal rects keep their order:
+        int source = 0;
+        for (int pass = 0; pass < RADIX_PASSES; pass++) {
+            const int shift   = pass * RADIX_BITS;
+            const u32* keys   = radix_keys[source].data();
+            const int* order  = radix_order[source].data();
+            u32* sorted_keys  = radix_keys[1 - source].data();
+            int* sorted_order = radix_order[1 - source].data();
+
+            int offsets[RADIX_BUCKETS] = {};
+            for (int i = 0; i < count; i++) {
+                offsets[(keys[i] >> shift) & (RADIX_BUCKETS - 1)] += 1;
+            }
+
+            int offset = 0;
+            for (int bucket = 0; bucket < RADIX_BUCKETS; bucket++) {
+                const int bucket_count = offsets[bucket];
+                offsets[bucket]        = offset;
+                offset                += bucket_count;
+            }
+
+            for (int i = 0; i < count; i++) {
+                const int target     = offsets[(keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+                sorted_keys[target]  = keys[i];
+                sorted_order[target] = order[i];
+            }
+
+            source = 1 - source;
+        }
+
+        const std::vector<int>& order = radix_order[source];
+
+        scratch_entities.resize(count, Entity(NO_POSITION));
+        for (int i = 0; i < count; i++) {
+            scratch_entities[i] = sweep_entities[order[i]];
+        }
+        sweep_entities.swap(scratch_entities);
+
+        scratch_bounds.resize(count);
+        for (std::vector<f32>* bounds: { &min_x, &max_x, &min_y, &max_y }) {
+            for (int i = 0; i < count; i++) {
+                scratch_bounds[i] = (*bounds)[order[i]];
+            }
+            bounds->swap(scratch_bounds);
+        }
+    }
+
+    void
+    Collision_System::set_bounds(int position, const Rect& rect) {
+        min_x[position] = rect.x;
+        max_x[position] = rect.x + rect.z;
+        min_y[position] = rect.y;
+        max_y[position] = rect.y + rect.w;
+    }
+
+    void
+    Collision_System::sweep(int begin, int end, std::vector<Contact>& result) const {
+        const Entity* entities = sweep_entities.data();
+        const f32* lefts       = min_x.data();
+        const f32* rights      = max_x.data();
+        const f32* tops        = min_y.data();
+        const f32* bottoms     = max_y.data();
+
+        for (int i = begin; i < end; i++) {
+        #if defined(__AVX2__)
+            const __m256 right  = _mm256_set1_ps(rights[i]);
+            const __m256 top    = _mm256_set1_ps(tops[i]);
+            const __m256 bottom = _mm256_set1_ps(bottoms[i]);
+
+            for (int j = i + 1;; j += 8) {
+                // Lanes which start before rect { i } ends, always a prefix since the lefts are sorted:
+                const __m256 starts_before = _mm256_cmp_ps(_mm256_loadu_ps(lefts + j), right, _CMP_LT_OQ);
+                const __m256 above_bottom  = _mm256_cmp_ps(_mm256_loadu_ps(tops + j), bottom, _CMP_LT_OQ);
+                const __m256 below_top     = _mm256_cmp_ps(top, _mm256_loadu_ps(bottoms + j), _CMP_LT_OQ);
+
+                const int in_range = _mm256_movemask_ps(starts_before);
+                add_contacts(entities, i, j, _mm256_movemask_ps(_mm256_and_ps(above_bottom, below_top)) & in_range, result);
+
+                if (in_range != 0xFF) {
+                    break;
+                }
+            }
+        #elif defined(__SSE2__) || defined(_M_X64)
+            const __m128 right  = _mm_set1_ps(rights[i]);
+            const __m128 top    = _mm_set1_ps(tops[i]);
+            const __m128 bottom = _mm_set1_ps(bottoms[i]);
+
+            for (int j = i + 1;; j += 4) {
+                const __m128 starts_before = _mm_cmplt_ps(_mm_loadu_ps(lefts + j), right);
+                const __m128 above_bottom  = _mm_cmplt_ps(_mm_loadu_ps(tops + j), bottom);
+                const __m128 below_top     = _mm_cmplt_ps(top, _mm_loadu_ps(bottoms + j));
+
+                const int in_range = _mm_movemask_ps(starts_before);
+                add_contacts(entities, i, j, _mm_movemask_ps(_mm_and_ps(above_bottom, below_top)) & in_range, result);
+
+                if (in_range != 0xF) {
+                    break;
+                }
+            }
+        #else
+            for (int j = i + 1; lefts[j] < rights[i]; j++) {
+                if (tops[j] < bottoms[i] && tops[i] < bottoms[j]) {
+                    result.push_back({ entities[i], entities[j] });
+                }
+            }
+        #endif
+        }
+    }
+
+} // jbx
@@ -0,0 +1,122 @@
+
+#pragma once
+#include <ecs/ecs.hpp>
+#include <engine/core/engine.hpp>
+
+namespace jbx {
+
+    /*
+        Two entities whose rects overlap, { a } is the one whose rect starts further left.
+    */
+    struct Contact {
+        Entity a;
+        Entity b;
+    };
+
+    /*
+        { Collision_System } finds every pair of overlapping { Rect }s (broad phase) with sort and sweep:
+        rects are sorted by their left edge, then every rect is only tested against the rects which start
+        before it ends.
+
+        Usage:
+            for (const Contact& contact: registry.get_system<Collision_System>().get_contacts()) {
+                ...
+            }
+
+        Bounds are kept as separate arrays of { min_x, max_x, min_y, max_y } in sweep order, only the bounds
+        of rects which changed since the last run are read again (see { Registry::each_changed }). The sweep
+        tests 8 rects at once with AVX2 (4 with SSE2). The order is kept between frames, rects only move a
+        little so it's restored with an insertion sort, which falls back to a radix sort if too much moved
+        (e.g. the first frame, or many entities teleported).
+
+        Rects must have a positive width and height, touching rects do not overlap. Contacts are replaced
+        in every { update }, they are ordered by the left edge of { a } so they don't depend on the number of
+        threads. Like the { Spatial_Index_System } it runs after { Basic_Velocity_System }, read the contacts
+        from the frontend or the render phase. They are also sent as { Contact } events, so systems of the
+        next frame can read them without depending on this one, see { Event_Bus }.
+    */
+    class Collision_System final : public Base_System {
+    private:
+        static constexpr int NO_POSITION = -1;
+
+        /*
+            Sweep order and bounds, entities which left the system are marked with an id of { NO_POSITION }
+            until the next update. { sweep_positions } maps entity ids into them.
+        */
+        std::vector<Entity> sweep_entities;
+        std::vector<int>    sweep_positions;
+        int                 removed_count = 0;
+
+        std::vector<f32> min_x;
+        std::vector<f32> max_x;
+        std::vector<f32> min_y;
+        std::vector<f32> max_y;
+
+        std::vector<Contact>              contacts;
+        std::vector<std::vector<Contact>> batch_contacts;
+        bool                              parallel = false;
+
+        // Full sort, ping-pong buffers of the radix passes:
+        std::vector<u32>    radix_keys[2];
+        std::vector<int>    radix_order[2];
+        std::vector<f32>    scratch_bounds;
+        std::vector<Entity> scratch_entities;
+
+    public:
+        Collision_System(bool parallel = false);
+        ~Collision_System() = default;
+
+        void
+        update(f64 delta_time) override;
+
+        /*
+            Pairs of overlapping rects found by the last { update }.
+        */
+        const std::vector<Contact>&
+        get_contacts() const;
+
+        /*
+            Split the sweep into batches on the { Job_System }, sorting stays on the thread of the system.
+        */
+        void
+        set_parallel(bool enabled);
+
+    protected:
+        void
+        on_entity_added(Entity entity) override;
+
+        void
+        on_entity_removed(Entity entity) override;
+
+    private:
+        /*
+            Remove the entities which left the system from every array, keeping the order of the rest.
+        */
+        void
+        compact();
+
+        /*
+            Sort the bounds by { min_x }, keeping the order of equal ones. Returns { false } if they were
+            already sorted.
+        */
+        bool
+        sort_bounds();
+
+        /*
+            Radix sort by { min_x }, for when the order from the last frame is of no use.
+        */
+        void
+        sort_bounds_from_scratch();
+
+        void
+        set_bounds(int position, const Rect& rect);
+
+        /*
+            Test the rects { begin..end } against the rects which follow them in sweep order, expects
+            { min_x } to be padded, see { SWEEP_PADDING }.
+        */
+        void
+        sweep(int begin, int end, std::vector<Contact>& result) const;
+    };
+
+} // jbx
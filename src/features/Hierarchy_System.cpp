@@ -0,0 +1,219 @@
+
+// Implements:
+#include <features/Hierarchy_System.hpp>
+
+// Dependencies (3rd party):
+#include <algorithm>
+
+namespace jbx {
+
+    static inline bool
+    equal_rects(const Rect& a, const Rect& b) {
+        return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
+    }
+
+    /*
+    ## Hierarchy_System: implementation
+    */
+
+    Hierarchy_System::Hierarchy_System() {
+        component_mask.add<Rect>();
+        component_mask.add<Parent>();
+        component_mask.add<Local_Rect>();
+
+        reads<Parent>();
+        reads<Local_Rect>();
+        writes<Rect>();
+    }
+
+    void
+    Hierarchy_System::update(f64) {
+        const int node_count = static_cast<int>(nodes.size());
+
+        registry->each_changed<Parent>(get_last_run_tick(), [&](Entity entity, const Parent&) {
+            if (entity.id < static_cast<int>(node_positions.size()) && node_positions[entity.id] != NO_NODE) {
+                order_changed = true;
+            }
+        });
+
+        if (order_changed) {
+            rebuild_order();
+            recompute(0, static_cast<int>(nodes.size()));
+            order_changed = false;
+            return;
+        }
+
+        dirty_ranges.clear();
+
+        registry->each_changed<Local_Rect>(get_last_run_tick(), [&](Entity entity, const Local_Rect&) {
+            if (entity.id < static_cast<int>(node_positions.size()) && node_positions[entity.id] != NO_NODE) {
+                const int position = node_positions[entity.id];
+                dirty_ranges.push_back({ position, nodes[position].size });
+            }
+        });
+
+        registry->each_changed<Rect>(get_last_run_tick(), [&](Entity entity, const Rect& rect) {
+            if (entity.id < static_cast<int>(node_positions.size()) && node_positions[entity.id] != NO_NODE) {
+                // Rects written by the last update come back as changed, only writes from elsewhere count:
+                const int position = node_positions[entity.id];
+                if (!equal_rects(rect, world_rects[position])) {
+                    dirty_ranges.push_back({ position, nodes[position].size });
+                }
+            } else if (entity.id < static_cast<int>(root_ranges.size()) && root_ranges[entity.id].count > 0) {
+                dirty_ranges.push_back(root_ranges[entity.id]);
+            }
+        });
+
+        // Subtrees are either nested or apart, so after sorting only the outermost ones are left to run:
+        std::sort(dirty_ranges.begin(), dirty_ranges.end(), [](const Range& a, const Range& b) {
+            return a.begin < b.begin || (a.begin == b.begin && a.count > b.count);
+        });
+
+        int covered_end = 0;
+        for (const Range& range: dirty_ranges) {
+            if (range.begin >= covered_end) {
+                recompute(range.begin, range.begin + range.count);
+                covered_end = range.begin + range.count;
+            }
+        }
+
+        EXPECT(covered_end <= node_count, "Dirty range past the last node!");
+    }
+
+    int
+    Hierarchy_System::get_node_count() const {
+        return static_cast<int>(nodes.size());
+    }
+
+    void
+    Hierarchy_System::on_entity_added(Entity) {
+        order_changed = true;
+    }
+
+    void
+    Hierarchy_System::on_entity_removed(Entity) {
+        order_changed = true;
+    }
+
+    void
+    Hierarchy_System::rebuild_order() {
+        const Component_Storage<Parent>& parents = registry->get_storage<Parent>();
+
+        int id_count = 0;
+        for (const Entity& entity: entities) {
+            id_count = std::max({ id_count, entity.id + 1, parents.get(entity.id).entity.id + 1 });
+        }
+
+        // Children of every member by the id of their parent, entities whose parent is no member are roots:
+        std::vector<int>    child_offsets(id_count + 1, 0);
+        std::vector<Entity> children(entities.size(), Entity(NO_NODE));
+        std::vector<Entity> top_level;
+
+        auto is_child_of_member = [&](Entity parent) {
+            return registry->is_alive(parent) && has_entity(parent);
+        };
+
+        for (const Entity& entity: entities) {
+            const Entity parent = parents.get(entity.id).entity;
+            if (is_child_of_member(parent)) {
+                child_offsets[parent.id + 1] += 1;
+            } else {
+                top_level.push_back(entity);
+            }
+        }
+
+        for (int id = 0; id < id_count; id++) {
+            child_offsets[id + 1] += child_offsets[id];
+        }
+
+        std::vector<int> next_child(child_offsets.begin(), child_offsets.end() - 1);
+        for (const Entity& entity: entities) {
+            const Entity parent = parents.get(entity.id).entity;
+            if (is_child_of_member(parent)) {
+                children[next_child[parent.id]++] = entity;
+            }
+        }
+
+        // Top level nodes of the same root next to each other, so its descendants are a single range:
+        std::stable_sort(top_level.begin(), top_level.end(), [&](Entity a, Entity b) {
+            return parents.get(a.id).entity.id < parents.get(b.id).entity.id;
+        });
+
+        nodes.clear();
+        node_positions.assign(id_count, NO_NODE);
+        root_ranges.assign(id_count, { 0, 0 });
+
+        // Depth first, children are pushed in reverse so they come out in the order they were found:
+        std::vector<Node> stack;
+        for (const Entity& root_child: top_level) {
+            const Entity root = parents.get(root_child.id).entity;
+            if (registry->is_alive(root)) {
+                Range& range = root_ranges[root.id];
+                range.begin  = range.count == 0 ? static_cast<int>(nodes.size()) : range.begin;
+            }
+
+            stack.push_back({ root_child, root, NO_NODE, 0 });
+            while (!stack.empty()) {
+                const Node node = stack.back();
+                stack.pop_back();
+
+                const int position             = static_cast<int>(nodes.size());
+                node_positions[node.entity.id] = position;
+                nodes.push_back(node);
+
+                const int first_child = child_offsets[node.entity.id];
+                for (int child = child_offsets[node.entity.id + 1] - 1; child >= first_child; child--) {
+                    stack.push_back({ children[child], node.entity, position, 0 });
+                }
+            }
+
+            if (registry->is_alive(root)) {
+                Range& range = root_ranges[root.id];
+                range.count  = static_cast<int>(nodes.size()) - range.begin;
+            }
+        }
+
+        ERROR_IF(nodes.size() != entities.size(), "Parents of the hierarchy form a cycle!");
+
+        // Children come after their parents, so going backwards every subtree is complete when it's added:
+        for (int position = static_cast<int>(nodes.size()) - 1; position >= 0; position--) {
+            Node& node = nodes[position];
+            node.size += 1;
+
+            if (node.parent_node != NO_NODE) {
+                nodes[node.parent_node].size += node.size;
+            }
+        }
+
+        world_rects.resize(nodes.size());
+    }
+
+    void
+    Hierarchy_System::recompute(int begin, int end) {
+        Component_Storage<Rect>& rects               = registry->get_storage<Rect>();
+        const Component_Storage<Rect>& current_rects = rects;
+        const Component_Storage<Local_Rect>& locals  = registry->get_storage<Local_Rect>();
+
+        for (int position = begin; position < end; position++) {
+            const Node& node = nodes[position];
+
+            f32x2 origin;
+            if (node.parent_node != NO_NODE) {
+                origin = f32x2(world_rects[node.parent_node].x, world_rects[node.parent_node].y);
+            } else if (registry->is_alive(node.parent) && current_rects.contains(node.parent.id)) {
+                const Rect& parent_rect = current_rects.get(node.parent.id);
+                origin                  = f32x2(parent_rect.x, parent_rect.y);
+            }
+
+            const Local_Rect& local = locals.get(node.entity.id);
+            const Rect world(origin.x + local.x, origin.y + local.y, local.z, local.w);
+            world_rects[position] = world;
+
+            // Unchanged rects are not written, so the systems which follow don't see them as changed:
+            if (!equal_rects(current_rects.get(node.entity.id), world)) {
+                rects.get(node.entity.id) = world;
+            }
+        }
+    }
+
+} // jbx
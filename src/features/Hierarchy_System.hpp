@@ -0,0 +1,92 @@
+
+#pragma once
+#include <ecs/ecs.hpp>
+#include <engine/core/engine.hpp>
+
+namespace jbx {
+
+    /*
+        { Hierarchy_System } derives the { Rect } of every child from the rect of its { Parent } and its own
+        { Local_Rect }, so moving a panel moves everything attached to it without touching the children.
+
+        Usage:
+            registry.add_component<Rect>(button);
+            registry.add_component<Parent>(button, panel);
+            registry.add_component<Local_Rect>(button, 8.0f, 8.0f, 64.0f, 24.0f);
+
+            registry.get_component<Rect>(panel).x += 100.0f; // The button follows in the next update.
+
+        Children are kept in a flat array in depth-first order, so every parent comes before its children and
+        the descendants of an entity are one contiguous range. Only the ranges below entities whose rect,
+        local rect (or that of an ancestor) changed since the last run are recomputed, see
+        { Registry::each_changed }. The order is rebuilt from scratch when children join or leave, or when a
+        { Parent } changes.
+
+        The { Rect } of a child is owned by this system, writes to it are overwritten in the next update,
+        change its { Local_Rect } instead. Roots are ordinary entities with a { Rect }, a child whose parent
+        was killed is placed relative to the origin. Parents must not form a cycle.
+
+        Runs after { Basic_Velocity_System } and before the systems which read rects, so they and the
+        renderers see the world rects of the same tick.
+    */
+    class Hierarchy_System final : public Base_System {
+    private:
+        static constexpr int NO_NODE = -1;
+
+        struct Node {
+            Entity entity;
+            Entity parent;
+            int    parent_node;  // Position of the parent, or { NO_NODE } if it's a root.
+            int    size;         // Number of nodes in the subtree, including this one.
+        };
+
+        // Nodes { begin..begin + count }, a subtree or every descendant of a root:
+        struct Range {
+            int begin;
+            int count;
+        };
+
+        std::vector<Node>  nodes;
+        std::vector<Rect>  world_rects;    // The rect last written for every node, by position.
+        std::vector<int>   node_positions; // By entity id.
+        std::vector<Range> root_ranges;    // Descendants of the roots, by entity id.
+        bool               order_changed = true;
+
+        // Ranges to recompute in this update:
+        std::vector<Range> dirty_ranges;
+
+    public:
+        Hierarchy_System();
+        ~Hierarchy_System() = default;
+
+        void
+        update(f64 delta_time) override;
+
+        /*
+            Number of entities with a parent.
+        */
+        int
+        get_node_count() const;
+
+    protected:
+        void
+        on_entity_added(Entity entity) override;
+
+        void
+        on_entity_removed(Entity entity) override;
+
+    private:
+        /*
+            Sort the children into depth-first order, from the { Parent } of every member.
+        */
+        void
+        rebuild_order();
+
+        /*
+            Compute and write the world rects of nodes { begin..end }, parents must already be up to date.
+        */
+        void
+        recompute(int begin, int end);
+    };
+
+} // jbx
@@ -0,0 +1,65 @@
+
+// Implements:
+#include <features/Interpolation_System.hpp>
+
+namespace jbx {
+
+    /*
+    ## Interpolation_System: implementation
+    */
+
+    Interpolation_System::Interpolation_System() {
+        component_mask.add<Rect>();
+        reads<Rect>();
+    }
+
+    void
+    Interpolation_System::update(f64) {
+    }
+
+    void
+    Interpolation_System::save_previous_rects() {
+        // Rects which did not change since the last save are still the same:
+        registry->each_changed<Rect>(saved_tick, [&](Entity entity, const Rect& rect) {
+            if (entity.id < static_cast<int>(previous_rects.size())) {
+                previous_rects[entity.id] = rect;
+            }
+        });
+
+        saved_tick = registry->get_change_tick();
+    }
+
+    void
+    Interpolation_System::set_alpha(f32 value) {
+        alpha = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+    }
+
+    f32
+    Interpolation_System::get_alpha() const {
+        return alpha;
+    }
+
+    Rect
+    Interpolation_System::interpolate(int entity_id, const Rect& current) const {
+        EXPECT(entity_id < static_cast<int>(previous_rects.size()), "Entity has no previous rect!");
+
+        const Rect& previous = previous_rects[entity_id];
+        return Rect(
+            previous.x + (current.x - previous.x) * alpha,
+            previous.y + (current.y - previous.y) * alpha,
+            previous.z + (current.z - previous.z) * alpha,
+            previous.w + (current.w - previous.w) * alpha
+        );
+    }
+
+    void
+    Interpolation_System::on_entity_added(Entity entity) {
+        if (entity.id >= static_cast<int>(previous_rects.size())) {
+            previous_rects.resize(entity.id + 1);
+        }
+
+        const Component_Storage<Rect>& rects = registry->get_storage<Rect>();
+        previous_rects[entity.id]            = rects.get(entity.id);
+    }
+
+} // jbx
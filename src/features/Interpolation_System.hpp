@@ -0,0 +1,64 @@
+
+#pragma once
+#include <ecs/ecs.hpp>
+#include <engine/core/engine.hpp>
+
+namespace jbx {
+
+    /*
+        { Interpolation_System } keeps the { Rect } every entity had at the start of the current simulation
+        tick, so renderers can draw in between two ticks when the simulation runs at a lower rate than the
+        frames are drawn, see { Engine_Instance::advance }.
+
+        Usage:
+            const Interpolation_System& interpolation = registry->get_system<Interpolation_System>();
+            draw_rect(interpolation.interpolate(entity.id, rect), color);
+
+        { save_previous_rects } is called by the instance at the start of every tick, before the frontend
+        step, so moves made by the user code are interpolated too. Only the rects which changed since the
+        previous save are copied, see { Registry::each_changed }. Entities which join start from the rect they
+        joined with.
+    */
+    class Interpolation_System final : public Base_System {
+    private:
+        std::vector<Rect> previous_rects;
+        u32               saved_tick = 0;
+        f32               alpha      = 1.0f;
+
+    public:
+        Interpolation_System();
+        ~Interpolation_System() = default;
+
+        /*
+            Nothing to do, the rects are saved by { save_previous_rects }.
+        */
+        void
+        update(f64 delta_time) override;
+
+        /*
+            Remember the current rect of every entity as the one it had at the start of the tick.
+        */
+        void
+        save_previous_rects();
+
+        /*
+            Where the render is in between the previous tick (0) and the current one (1).
+        */
+        void
+        set_alpha(f32 value);
+
+        f32
+        get_alpha() const;
+
+        /*
+            The { current } rect of the entity blended with its previous one by the alpha.
+        */
+        Rect
+        interpolate(int entity_id, const Rect& current) const;
+
+    protected:
+        void
+        on_entity_added(Entity entity) override;
+    };
+
+} // jbx
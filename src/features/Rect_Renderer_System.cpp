@@ -4,22 +4,34 @@
 
 // Dependencies:
 #include <engine/core/engine.hpp>
+#include <features/Interpolation_System.hpp>
 
 namespace jbx {
 
     Rect_Renderer_System::Rect_Renderer_System() {
         component_mask.add<Rect>();
         component_mask.add<Color>();
+
+        reads<Rect>();
+        reads<Color>();
+
+        // Draw calls must be made from the main thread:
+        phase = System_Phase_Render;
+        flags = System_Flags_Main_Thread;
     }
 
     void
     Rect_Renderer_System::update(f64 delta_time) {
-        Unique<Registry>& registry = get_context<Registry>();
+        // Read only, so drawing does not mark the components as changed:
+        const Component_Storage<Rect>& transforms   = registry->get_storage<Rect>();
+        const Component_Storage<Color>& tint_colors = registry->get_storage<Color>();
+        const Interpolation_System& interpolation   = registry->get_system<Interpolation_System>();
+
         for (auto& entity: entities) {
-            Rect& transform   = registry->get_component<Rect>(entity);
-            Color& tint_color = registry->get_component<Color>(entity);
+            const Rect& transform   = transforms.get(entity.id);
+            const Color& tint_color = tint_colors.get(entity.id);
 
-            draw_rect(transform, tint_color);
+            draw_rect(interpolation.interpolate(entity.id, transform), tint_color);
         }
     }
 
@@ -0,0 +1,303 @@
+
+// Implements:
+#include <features/Spatial_Index_System.hpp>
+
+// Dependencies (3rd party):
+#include <algorithm>
+#include <cmath>
+
+namespace jbx {
+
+    static inline bool
+    overlaps(const Rect& a, const Rect& b) {
+        return a.x < b.x + b.z && b.x < a.x + a.z && a.y < b.y + b.w && b.y < a.y + a.w;
+    }
+
+    static inline bool
+    contains(const Rect& rect, f32x2 point) {
+        return point.x >= rect.x && point.x < rect.x + rect.z && point.y >= rect.y && point.y < rect.y + rect.w;
+    }
+
+    static inline f32
+    squared_distance(const Rect& rect, f32x2 point) {
+        const f32 dx = std::max({ rect.x - point.x, 0.0f, point.x - (rect.x + rect.z) });
+        const f32 dy = std::max({ rect.y - point.y, 0.0f, point.y - (rect.y + rect.w) });
+
+        return dx * dx + dy * dy;
+    }
+
+    /*
+    ## Spatial_Index_System: implementation
+    */
+
+    Spatial_Index_System::Spatial_Index_System(f32 cell_size)
+    : cell_size(cell_size) {
+        ERROR_IF(cell_size <= 0.0f, "Spatial index cell size must be positive!");
+
+        component_mask.add<Rect>();
+        reads<Rect>();
+    }
+
+    void
+    Spatial_Index_System::update(f64) {
+        // Entities which joined since the last run are already in, with their current rect:
+        registry->each_changed<Rect>(get_last_run_tick(), [&](Entity entity, const Rect& rect) {
+            if (entity.id < static_cast<int>(locations.size()) && locations[entity.id].cell != NO_CELL) {
+                move(entity.id, rect);
+            }
+        });
+    }
+
+    void
+    Spatial_Index_System::query_region(const Rect& region, std::vector<Entity>& result) const {
+        result.clear();
+
+        // Centers of the rects which overlap the region are at most one cell outside of it:
+        each_item(
+            to_cell(region.x - cell_size),
+            to_cell(region.y - cell_size),
+            to_cell(region.x + region.z + cell_size),
+            to_cell(region.y + region.w + cell_size),
+            [&](const Item& item) {
+                if (overlaps(item.rect, region)) {
+                    result.push_back(item.entity);
+                }
+            }
+        );
+    }
+
+    void
+    Spatial_Index_System::query_point(f32x2 point, std::vector<Entity>& result) const {
+        result.clear();
+
+        each_item(
+            to_cell(point.x - cell_size),
+            to_cell(point.y - cell_size),
+            to_cell(point.x + cell_size),
+            to_cell(point.y + cell_size),
+            [&](const Item& item) {
+                if (contains(item.rect, point)) {
+                    result.push_back(item.entity);
+                }
+            }
+        );
+    }
+
+    void
+    Spatial_Index_System::query_nearest(f32x2 point, int count, std::vector<Entity>& result) const {
+        result.clear();
+        if (count <= 0) {
+            return;
+        }
+
+        struct Candidate {
+            f32    distance;
+            Entity entity;
+        };
+
+        // Max-heap of the nearest candidates so far, the farthest one is replaced first:
+        std::vector<Candidate> nearest;
+        nearest.reserve(count);
+
+        auto is_nearer = [](const Candidate& a, const Candidate& b) {
+            return a.distance < b.distance;
+        };
+
+        auto consider = [&](const Item& item) {
+            const f32 distance = squared_distance(item.rect, point);
+            if (static_cast<int>(nearest.size()) < count) {
+                nearest.push_back({ distance, item.entity });
+                std::push_heap(nearest.begin(), nearest.end(), is_nearer);
+            } else if (distance < nearest.front().distance) {
+                std::pop_heap(nearest.begin(), nearest.end(), is_nearer);
+                nearest.back() = { distance, item.entity };
+                std::push_heap(nearest.begin(), nearest.end(), is_nearer);
+            }
+        };
+
+        for (const Item& item: large_items) {
+            consider(item);
+        }
+
+        const s32 center_x = to_cell(point.x);
+        const s32 center_y = to_cell(point.y);
+        int visited        = 0;
+
+        auto visit_cell = [&](s64 x, s64 y) {
+            const int cell = find_cell(static_cast<s32>(x), static_cast<s32>(y));
+            if (cell == NO_CELL) {
+                return;
+            }
+
+            for (const Item& item: cells[cell].items) {
+                consider(item);
+            }
+
+            visited += static_cast<int>(cells[cell].items.size());
+        };
+
+        // Search rings of cells around the point, until nothing further out can be nearer:
+        for (s64 ring = 0; visited < small_count; ring++) {
+            // Rects centered in this ring or beyond are at least { ring - 2 } cells away from the point:
+            if (static_cast<int>(nearest.size()) == count && ring >= 2) {
+                const f32 bound = static_cast<f32>(ring - 2) * cell_size;
+                if (nearest.front().distance <= bound * bound) {
+                    break;
+                }
+            }
+
+            // Sparse grid, walking the remaining cells is cheaper than looking up every cell of the ring:
+            if (8 * ring > static_cast<s64>(cells.size())) {
+                for (const Cell& cell: cells) {
+                    const s64 cell_ring = std::max(
+                        std::abs(static_cast<s64>(cell.x) - center_x), std::abs(static_cast<s64>(cell.y) - center_y)
+                    );
+
+                    if (cell_ring >= ring) {
+                        for (const Item& item: cell.items) {
+                            consider(item);
+                        }
+                    }
+                }
+
+                break;
+            }
+
+            if (ring == 0) {
+                visit_cell(center_x, center_y);
+                continue;
+            }
+
+            for (s64 offset = -ring; offset <= ring; offset++) {
+                visit_cell(center_x + offset, center_y - ring);
+                visit_cell(center_x + offset, center_y + ring);
+            }
+
+            for (s64 offset = -ring + 1; offset < ring; offset++) {
+                visit_cell(center_x - ring, center_y + offset);
+                visit_cell(center_x + ring, center_y + offset);
+            }
+        }
+
+        std::sort_heap(nearest.begin(), nearest.end(), is_nearer);
+        for (const Candidate& candidate: nearest) {
+            result.push_back(candidate.entity);
+        }
+    }
+
+    f32
+    Spatial_Index_System::get_cell_size() const {
+        return cell_size;
+    }
+
+    int
+    Spatial_Index_System::get_entity_count() const {
+        return small_count + static_cast<int>(large_items.size());
+    }
+
+    void
+    Spatial_Index_System::on_entity_added(Entity entity) {
+        const Component_Storage<Rect>& rects = registry->get_storage<Rect>();
+        insert(entity, rects.get(entity.id));
+    }
+
+    void
+    Spatial_Index_System::on_entity_removed(Entity entity) {
+        remove(entity.id);
+    }
+
+    void
+    Spatial_Index_System::insert(Entity entity, const Rect& rect) {
+        if (entity.id >= static_cast<int>(locations.size())) {
+            locations.resize(entity.id + 1, { NO_CELL, 0 });
+        }
+
+        if (is_large(rect)) {
+            locations[entity.id] = { LARGE_CELL, static_cast<int>(large_items.size()) };
+            large_items.push_back({ rect, entity });
+            return;
+        }
+
+        const int cell           = get_cell(to_cell(rect.x + rect.z * 0.5f), to_cell(rect.y + rect.w * 0.5f));
+        std::vector<Item>& items = cells[cell].items;
+
+        locations[entity.id] = { cell, static_cast<int>(items.size()) };
+        items.push_back({ rect, entity });
+        small_count += 1;
+    }
+
+    void
+    Spatial_Index_System::remove(int entity_id) {
+        Location& location = locations[entity_id];
+        EXPECT(location.cell != NO_CELL, "Entity is not in the spatial index!");
+
+        std::vector<Item>& items = location.cell == LARGE_CELL ? large_items : cells[location.cell].items;
+        if (location.cell != LARGE_CELL) {
+            small_count -= 1;
+        }
+
+        // Swap the last item into the removed slot:
+        items[location.slot]                           = items.back();
+        locations[items[location.slot].entity.id].slot = location.slot;
+        items.pop_back();
+
+        location = { NO_CELL, 0 };
+    }
+
+    void
+    Spatial_Index_System::move(int entity_id, const Rect& rect) {
+        const Location location = locations[entity_id];
+
+        if (location.cell == LARGE_CELL && is_large(rect)) {
+            large_items[location.slot].rect = rect;
+            return;
+        }
+
+        if (location.cell != LARGE_CELL && !is_large(rect)) {
+            Cell& cell = cells[location.cell];
+            if (cell.x == to_cell(rect.x + rect.z * 0.5f) && cell.y == to_cell(rect.y + rect.w * 0.5f)) {
+                cell.items[location.slot].rect = rect;
+                return;
+            }
+        }
+
+        const Entity entity = location.cell == LARGE_CELL
+            ? large_items[location.slot].entity
+            : cells[location.cell].items[location.slot].entity;
+
+        remove(entity_id);
+        insert(entity, rect);
+    }
+
+    bool
+    Spatial_Index_System::is_large(const Rect& rect) const {
+        // Half of the rect must fit into a cell, so it does not reach past the neighbouring cells:
+        return rect.z > 2.0f * cell_size || rect.w > 2.0f * cell_size;
+    }
+
+    s32
+    Spatial_Index_System::to_cell(f32 position) const {
+        return static_cast<s32>(std::floor(position / cell_size));
+    }
+
+    int
+    Spatial_Index_System::get_cell(s32 x, s32 y) {
+        const u64 key         = (static_cast<u64>(static_cast<u32>(x)) << 32) | static_cast<u32>(y);
+        auto [iter, new_cell] = cell_indices.try_emplace(key, static_cast<int>(cells.size()));
+
+        if (new_cell) {
+            cells.push_back({ x, y, {} });
+        }
+
+        return iter->second;
+    }
+
+    int
+    Spatial_Index_System::find_cell(s32 x, s32 y) const {
+        const u64 key = (static_cast<u64>(static_cast<u32>(x)) << 32) | static_cast<u32>(y);
+        auto iter     = cell_indices.find(key);
+
+        return iter != cell_indices.end() ? iter->second : NO_CELL;
+    }
+
+} // jbx
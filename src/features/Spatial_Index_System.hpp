@@ -0,0 +1,183 @@
+
+#pragma once
+#include <ecs/ecs.hpp>
+#include <engine/core/engine.hpp>
+
+// Dependencies (3rd party):
+#include <unordered_map>
+
+namespace jbx {
+
+    /*
+        { Spatial_Index_System } keeps the { Rect } of every entity in a uniform hash grid, so region, point
+        and nearest queries only visit the entities around them instead of every entity.
+
+        Usage:
+            Spatial_Index_System& index = registry.get_system<Spatial_Index_System>();
+
+            std::vector<Entity> found;
+            index.query_point(f32x2(mouse_x, mouse_y), found);
+
+        The grid is loose: an entity is stored in the one cell which holds the center of its rect and queries
+        look one cell further out, so a rect may be up to two cells wide and high. Larger rects (backgrounds,
+        panels) are kept in a separate list which every query checks. Cells are found through a hash map of
+        their coordinates, so the world has no bounds and empty space costs nothing.
+
+        Entities join and leave the index with the system, { update } moves only the entities whose rect
+        changed since its previous run, see { Registry::each_changed }. It's registered after
+        { Basic_Velocity_System }, queries see the rects as of the end of the last update phase. Queries may
+        be made from the frontend or the render phase, not from update systems running next to this one.
+    */
+    class Spatial_Index_System final : public Base_System {
+    private:
+        struct Item {
+            Rect   rect;
+            Entity entity;
+        };
+
+        struct Cell {
+            s32               x;
+            s32               y;
+            std::vector<Item> items;
+        };
+
+        // Where the item of an entity is, by entity id:
+        struct Location {
+            int cell;
+            int slot;
+        };
+
+        static constexpr int NO_CELL    = -1;
+        static constexpr int LARGE_CELL = -2;
+
+        f32                          cell_size;
+        std::vector<Cell>            cells;
+        std::unordered_map<u64, int> cell_indices;
+        std::vector<Item>            large_items;
+        std::vector<Location>        locations;
+        int                          small_count = 0;
+
+    public:
+        static constexpr f32 DEFAULT_CELL_SIZE = 64.0f;
+
+        Spatial_Index_System(f32 cell_size = DEFAULT_CELL_SIZE);
+        ~Spatial_Index_System() = default;
+
+        void
+        update(f64 delta_time) override;
+
+        /*
+            Entities whose rect overlaps the { region }, in no particular order.
+        */
+        void
+        query_region(const Rect& region, std::vector<Entity>& result) const;
+
+        /*
+            Entities whose rect contains the { point }, in no particular order.
+        */
+        void
+        query_point(f32x2 point, std::vector<Entity>& result) const;
+
+        /*
+            Up to { count } entities closest to the { point }, nearest first. Distance is measured to the
+            closest point of the rect, so it's 0 for every rect containing the point.
+        */
+        void
+        query_nearest(f32x2 point, int count, std::vector<Entity>& result) const;
+
+        f32
+        get_cell_size() const;
+
+        int
+        get_entity_count() const;
+
+    protected:
+        void
+        on_entity_added(Entity entity) override;
+
+        void
+        on_entity_removed(Entity entity) override;
+
+    private:
+        void
+        insert(Entity entity, const Rect& rect);
+
+        void
+        remove(int entity_id);
+
+        /*
+            Update the rect of an indexed entity, it only changes cell if its center crossed into another one.
+        */
+        void
+        move(int entity_id, const Rect& rect);
+
+        bool
+        is_large(const Rect& rect) const;
+
+        s32
+        to_cell(f32 position) const;
+
+        /*
+            Index of the cell, created if it does not exist yet.
+        */
+        int
+        get_cell(s32 x, s32 y);
+
+        /*
+            Index of the cell, or { NO_CELL } if it does not exist.
+        */
+        int
+        find_cell(s32 x, s32 y) const;
+
+        /*
+            Call { fn(const Item&) } for every item whose center is in cells { min_x..max_x, min_y..max_y },
+            and for every large item. Walks every cell instead of looking them up if the range is larger.
+        */
+        template <typename T_Fn>
+        void
+        each_item(s32 min_x, s32 min_y, s32 max_x, s32 max_y, T_Fn&& fn) const;
+    };
+
+    /*
+    ## Spatial_Index_System: template implementations
+    */
+
+    template <typename T_Fn>
+    void
+    Spatial_Index_System::each_item(s32 min_x, s32 min_y, s32 max_x, s32 max_y, T_Fn&& fn) const {
+        for (const Item& item: large_items) {
+            fn(item);
+        }
+
+        if (max_x < min_x || max_y < min_y) {
+            return;
+        }
+
+        const s64 range_cells = (static_cast<s64>(max_x) - min_x + 1) * (static_cast<s64>(max_y) - min_y + 1);
+        if (range_cells > static_cast<s64>(cells.size())) {
+            for (const Cell& cell: cells) {
+                if (cell.x >= min_x && cell.x <= max_x && cell.y >= min_y && cell.y <= max_y) {
+                    for (const Item& item: cell.items) {
+                        fn(item);
+                    }
+                }
+            }
+
+            return;
+        }
+
+        for (s32 y = min_y; y <= max_y; y++) {
+            for (s32 x = min_x; x <= max_x; x++) {
+                const int cell = find_cell(x, y);
+                if (cell == NO_CELL) {
+                    continue;
+                }
+
+                for (const Item& item: cells[cell].items) {
+                    fn(item);
+                }
+            }
+        }
+    }
+
+} // jbx
@@ -4,22 +4,35 @@
 
 // Dependencies:
 #include <engine/core/engine.hpp>
+#include <features/Interpolation_System.hpp>
 
 namespace jbx {
 
     Text_Renderer_System::Text_Renderer_System() {
         component_mask.add<Rect>();
         component_mask.add<Text>();
+
+        reads<Rect>();
+        reads<Text>();
+
+        // Draw calls must be made from the main thread:
+        phase = System_Phase_Render;
+        flags = System_Flags_Main_Thread;
     }
 
     void
     Text_Renderer_System::update(f64 delta_time) {
-        Unique<Registry>& registry = get_context<Registry>();
+        // Read only, so drawing does not mark the components as changed:
+        const Component_Storage<Rect>& rects      = registry->get_storage<Rect>();
+        const Component_Storage<Text>& texts      = registry->get_storage<Text>();
+        const Interpolation_System& interpolation = registry->get_system<Interpolation_System>();
+
         for (auto& entity: entities) {
-            Rect& rect = registry->get_component<Rect>(entity);
-            Text& text = registry->get_component<Text>(entity);
+            const Rect& rect = rects.get(entity.id);
+            const Text& text = texts.get(entity.id);
 
-            draw_text(text, {rect.x, rect.y});
+            const Rect position = interpolation.interpolate(entity.id, rect);
+            draw_text(text, {position.x, position.y});
         }
     }
 
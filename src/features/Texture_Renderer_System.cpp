@@ -4,22 +4,34 @@
 
 // Dependencies:
 #include <engine/core/engine.hpp>
+#include <features/Interpolation_System.hpp>
 
 namespace jbx {
 
     Texture_Renderer_System::Texture_Renderer_System() {
         component_mask.add<Rect>();
         component_mask.add<Texture>();
+
+        reads<Rect>();
+        reads<Texture>();
+
+        // Draw calls must be made from the main thread:
+        phase = System_Phase_Render;
+        flags = System_Flags_Main_Thread;
     }
 
     void
     Texture_Renderer_System::update(f64 delta_time) {
-        Unique<Registry>& registry = get_context<Registry>();
+        // Read only, so drawing does not mark the components as changed:
+        const Component_Storage<Rect>& rects       = registry->get_storage<Rect>();
+        const Component_Storage<Texture>& textures = registry->get_storage<Texture>();
+        const Interpolation_System& interpolation  = registry->get_system<Interpolation_System>();
+
         for (auto& entity: entities) {
-            Rect& rect       = registry->get_component<Rect>(entity);
-            Texture& texture = registry->get_component<Texture>(entity);
+            const Rect& rect       = rects.get(entity.id);
+            const Texture& texture = textures.get(entity.id);
 
-            draw_texture(texture, rect);
+            draw_texture(texture, interpolation.interpolate(entity.id, rect));
         }
     }
 
@@ -2,6 +2,10 @@
 #pragma once
 
 #include <features/Basic_Velocity_System.hpp>
+#include <features/Collision_System.hpp>
+#include <features/Hierarchy_System.hpp>
+#include <features/Interpolation_System.hpp>
 #include <features/Rect_Renderer_System.hpp>
+#include <features/Spatial_Index_System.hpp>
 #include <features/Text_Renderer_System.hpp>
 #include <features/Texture_Renderer_System.hpp>
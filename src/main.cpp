@@ -1,6 +1,12 @@
 
 // Dependencies:
 #include <engine/core/engine.hpp>
+#include <engine/core/engine_instance.hpp>
+
+// Dependencies (3rd party):
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 using namespace jbx;
 
@@ -24,12 +30,27 @@ using namespace jbx;
         return 0;
     }
 #else
+    /*
+        Usage: { CV [root_dir] [--batch <instances> <ticks>] }
+
+        With { --batch } the game runs headless, see { run_batch }, and the aggregate ticks per second are
+        printed instead of opening a window.
+    */
     int
     main(int argc, cstr_t argv[]) {
         // User may supply a root directory, this is useful for testing:
         cstr_t user_root_dir = "";
-        if (argc > 1) {
-            user_root_dir = argv[1];
+        int batch_instances  = 0;
+        int batch_ticks      = 0;
+
+        for (int i = 1; i < argc; i++) {
+            if (std::strcmp(argv[i], "--batch") == 0 && i + 2 < argc) {
+                batch_instances = std::atoi(argv[i + 1]);
+                batch_ticks     = std::atoi(argv[i + 2]);
+                i += 2;
+            } else {
+                user_root_dir = argv[i];
+            }
         }
 
         // Configure & run:
@@ -40,6 +61,18 @@ using namespace jbx;
         config.window_height     = 720;
         // config.flags             = Engine_Flags_No_Decoration;
 
+        if (batch_instances > 0) {
+            Batch_Stats stats = run_batch(validate_config(config), batch_instances, batch_ticks);
+            std::printf(
+                "%d instances, %llu ticks in %.3f s: %.1f ticks/s\n",
+                stats.instance_count,
+                static_cast<unsigned long long>(stats.tick_count),
+                stats.duration_s,
+                stats.ticks_per_second
+            );
+            return 0;
+        }
+
         initialize_and_start(config);
         return 0;
     }